@@ -3,14 +3,21 @@
 
 #include "utilities/utils.h"
 #include "utilities/jbutil.h"
+#include "utilities/profiler.h"
+#include "utilities/bandwidth.h"
 #include "convolve.h"
 #include "io.h"
 #include "filters.h"
 #include "inverse.h"
+#include "dicom.h"
+#include "workspace.h"
+#include "levels.h"
+#include "stats.h"
 
 #include <string>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
@@ -23,14 +30,125 @@ public:
     DWT(const float* lpf, const float* hpf, size_t filter_size);
    
     // Function to perform 3D Discrete Wavelet Transform on the input data
-    Array3D<float> dwt_3d(const Array3D<float>& data, int levels) const;
+    // (levels may be one number, or one per axis: see AxisLevels)
+    Array3D<float> dwt_3d(const Array3D<float>& data, const AxisLevels& levels) const;
+
+    // Perform the transform into a caller-owned result, drawing all scratch memory and
+    // threads from the workspace (no allocations once result and workspace are sized),
+    // and add the bands of each level to the statistics as soon as they are final, if given
+    void dwt_3d(const Array3D<float>& data, Array3D<float>& result, const AxisLevels& levels, DWTWorkspace& workspace,
+                SubbandStatistics* statistics = nullptr) const;
+
+    // Perform the transform between views of caller-owned memory with any strides (in place if they are the same)
+    void dwt_3d(Array3DView<const float> data, Array3DView<float> result, const AxisLevels& levels, DWTWorkspace& workspace,
+                SubbandStatistics* statistics = nullptr) const;
+
+    // Bring the coefficients of a transform up to date after some depth slices of its input changed, given
+    // the slices before and after the change, with work proportional to the change (see the definition)
+    void dwt_3d_update(Array3DView<const float> previous, Array3DView<const float> current, Array3DView<float> coefficients,
+                       const vector<size_t>& changed_slices, const AxisLevels& levels, DWTWorkspace& workspace) const;
+
+    // Function to perform the 3D Discrete Wavelet Transform in place on a tiled array
+    void dwt_3d(TiledArray3D<float>& data, const AxisLevels& levels, DWTWorkspace* workspace = nullptr) const;
+
+    // Perform the transform as dwt_3d, but with the LLL band of each deeper level moved into a
+    // compact buffer of its own (the compact layout); the result is laid out as by dwt_3d
+    void dwt_3d_compact(Array3DView<const float> data, Array3DView<float> result, const AxisLevels& levels, DWTWorkspace& workspace) const;
+
+    // Perform a 2D transform of each depth slice on its own (rows and columns only), with the
+    // slices shared out between the workspace threads (or the lines of each pass, if there are
+    // fewer slices than threads); the same as dwt_3d with AxisLevels(levels, levels, 0)
+    void dwt_2d(Array3DView<const float> data, Array3DView<float> result, int levels, DWTWorkspace& workspace) const;
 
 private:
+    // Convolve one level within its bounds along the axes that still have levels
+    void transform_level(Array3DView<float> bounds, const AxisLevels& levels, int level, DWTWorkspace* workspace) const;
+
     // Convolution object used for performing convolutions across dimensions
     Convolve convolve;
 };
 
-// Function to perform the transform
-void perform_transform(const string& binary_filename, const string& output_filename, const string& filter_type, int levels);
+// Optional settings for the transform, set from command line options
+struct TransformOptions {
+    // Read the input from this DICOM series directory instead of the binary file
+    string dicom_directory;
+
+    // Read the input from this binary PGM/PPM image (one slice per channel) instead; implies slices_2d
+    string image_file;
+
+    // Transform each depth slice on its own in 2D (rows and columns), with the slices in parallel
+    bool slices_2d = false;
+
+    // Temporal levels of a 4D series (a shape file "frames,depth,rows,cols"); negative for as many
+    // as the spatial levels, or as the length of the series allows
+    int time_levels = -1;
+
+    // Sample type of the binary input (float32/int16/uint16); empty uses the shape file
+    string dtype;
+
+    // Memory layout used for the transform: linear, compact (linear, with each deeper level in a packed
+    // buffer), tiled (Z-order tiles) or tiled-linear (tile-major); empty for the tuned layout, or linear
+    // if there is none
+    string layout;
+
+    // Instruction set of the kernels (auto, sse2, avx2 or avx512); empty for the tuned one, or DWT_ISA or auto
+    string isa;
+
+    // Worker threads of the passes; 0 for the tuned number, or DWT_THREADS or the hardware count
+    size_t threads = 0;
+
+    // Time the candidate layouts, instruction sets and thread counts first and store the fastest
+    // in the tuning database (see tuning.h); with use_tuning, the stored settings are used when
+    // the options do not give them
+    bool autotune = false;
+    bool use_tuning = true;
+
+    // Record the time of each stage, level, axis and thread, print a summary and
+    // (if trace_file is set) write a Chrome trace-event file
+    bool profile = false;
+    string trace_file;
+
+    // Also record these performance counters in every span (comma separated, empty for the
+    // defaults), if counters is set
+    bool counters = false;
+    string counter_list;
+
+    // Measure the peak memory bandwidth first and report each kernel's GB/s and GFLOP/s against it
+    bool roofline = false;
+
+    // Print the memory held by each stage and its peak, next to the predicted peak
+    bool memory = false;
+
+    // Only predict the peak memory from the shape file, filter and layout, without reading or allocating
+    bool dry_run = false;
+
+    // Serve transform, inverse and denoise requests on this Unix socket instead of transforming one volume
+    string socket_path;
+
+    // Treat the filter and levels arguments as comma separated lists and sweep their combinations
+    // (see perform_sweep), also writing the results as CSV to sweep_file if it is set
+    bool sweep = false;
+    string sweep_file;
+
+    // Magnitude below which a detail coefficient counts as zero in the sweep statistics; negative to estimate it
+    // (in the subband statistics, negative counts only exact zeros)
+    float threshold = -1.0f;
+
+    // Gather the energy, mean, variance, range, zero fraction and magnitude histogram of every
+    // subband during the transform and write them to a JSON file next to the coefficients
+    bool stats = false;
+};
+
+// Predicted allocations of a run of perform_transform
+struct MemoryEstimate {
+    vector<pair<string, size_t>> buffers; // name and bytes of each large buffer
+    size_t peak = 0;                      // bytes allocated at once at the peak
+};
+
+// Predict the allocations of a transform of a volume with the given layout
+MemoryEstimate estimate_memory(size_t depth, size_t rows, size_t cols, size_t filter_size, const string& layout, size_t threads = thread_count());
+
+// Function to perform the transform (the command line driver in src/transform.cpp, which is not part of libdwt)
+void perform_transform(const string& binary_filename, const string& output_filename, const string& filter_type, const AxisLevels& levels, const TransformOptions& options = TransformOptions());
 
 #endif // DWT_H
\ No newline at end of file
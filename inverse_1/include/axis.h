@@ -0,0 +1,159 @@
+#ifndef AXIS_H
+#define AXIS_H
+
+#include "utilities/utils.h"
+#include "utilities/profiler.h"
+#include "workspace.h"
+#include "kernels.h"
+
+using namespace std;
+
+/*
+ * Line kernels of one transform, as chosen once by Convolve and Inverse
+ * - strided: for lines whose elements are any distance apart (rows and depths of a linear volume)
+ * - contiguous: the same kernel compiled for unit-stride lines (columns and line buffers)
+ */
+struct AxisKernels {
+    LineKernel strided;
+    LineKernel contiguous;
+};
+
+/*
+ * Reorder the axes of a view so that the lines along 'axis' run along its columns
+ * The depth of the result is the axis the lines are shared out over between threads
+ * and its rows are the lines each thread walks through, in the order that keeps
+ * neighbouring lines adjacent in memory (the columns innermost where possible).
+ * Parameters:
+ * - data: the view to reorder
+ * - axis: 0 = rows, 1 = columns, 2 = depth
+ */
+template <class T>
+Array3DView<T> lines_along(Array3DView<T> data, int axis) {
+    T* base = data.address(0, 0, 0);
+    switch (axis) {
+        case 0:
+            return Array3DView<T>(base, data.get_depth(), data.get_cols(), data.get_rows(),
+                                  data.get_slice_stride(), data.get_col_stride(), data.get_row_stride());
+        case 1:
+            return data;
+        default:
+            return Array3DView<T>(base, data.get_rows(), data.get_cols(), data.get_depth(),
+                                  data.get_row_stride(), data.get_col_stride(), data.get_slice_stride());
+    }
+}
+
+/*
+ * Reorder the axes of a stack of slices so that every line of every slice along 'axis'
+ * can be shared out between threads
+ * The lines run along the columns of the result and its depth is the other in-plane
+ * axis, so a pass along its columns (dim1) splits the work by line instead of by slice.
+ * Used when there are fewer slices than threads (e.g. the one slice of a PGM).
+ * Parameters:
+ * - data: the slices
+ * - axis: 0 = rows, 1 = columns
+ */
+template <class T>
+Array3DView<T> slice_lines(Array3DView<T> data, int axis) {
+    T* base = data.address(0, 0, 0);
+    if (axis == 0) {
+        return Array3DView<T>(base, data.get_cols(), data.get_depth(), data.get_rows(),
+                              data.get_col_stride(), data.get_slice_stride(), data.get_row_stride());
+    }
+    return Array3DView<T>(base, data.get_rows(), data.get_depth(), data.get_cols(),
+                          data.get_row_stride(), data.get_slice_stride(), data.get_col_stride());
+}
+
+/*
+ * Apply a line kernel to every line of a block of lines
+ * Contiguous is fixed at compile time, so the unit-stride version passes constant
+ * strides to a kernel compiled for them and the strided one passes the view strides.
+ * Parameters:
+ * - in, out: the lines of the input and output, as laid out by lines_along
+ * - kernel: the line kernel
+ * - lpf, hpf, filter_size: the filters
+ * - workspace: threads to run on, or nullptr for new threads
+ * - serial: run on the calling thread instead (e.g. from inside a parallel_for over slices)
+ */
+template <bool Contiguous>
+void transform_lines(Array3DView<const float> in, Array3DView<float> out, LineKernel kernel,
+                     const float* lpf, const float* hpf, size_t filter_size, DWTWorkspace* workspace, bool serial) {
+    size_t limit1 = out.get_depth();
+    size_t limit2 = out.get_rows();
+    size_t limit3 = out.get_cols();
+    ptrdiff_t in_stride = Contiguous ? 1 : in.get_col_stride();
+    ptrdiff_t out_stride = Contiguous ? 1 : out.get_col_stride();
+
+    auto lines = [&](size_t a, size_t) {
+        for (size_t b = 0; b < limit2; ++b) {
+            kernel(in.address(a, b, 0), in_stride, out.address(a, b, 0), out_stride, limit3, lpf, hpf, filter_size);
+        }
+    };
+    if (serial) {
+        for (size_t a = 0; a < limit1; ++a) {
+            lines(a, 0);
+        }
+    } else {
+        parallel_for(workspace, 0, limit1, lines);
+    }
+}
+
+// Transform the lines along an axis from a copy of a view back into it, choosing the kernel for their stride
+inline void transform_copy(Array3DView<const float> temp, Array3DView<float> data, int axis, const AxisKernels& kernels,
+                           const float* lpf, const float* hpf, size_t filter_size, DWTWorkspace* workspace, bool serial) {
+    Array3DView<const float> in = lines_along(temp, axis);
+    Array3DView<float> out = lines_along(data, axis);
+
+    if (in.get_col_stride() == 1 && out.get_col_stride() == 1) {
+        transform_lines<true>(in, out, kernels.contiguous, lpf, hpf, filter_size, workspace, serial);
+    } else {
+        transform_lines<false>(in, out, kernels.strided, lpf, hpf, filter_size, workspace, serial);
+    }
+}
+
+/*
+ * Transform along one axis over the whole of a (sub-volume) view
+ * This is the one pass behind dim0, dim1 and dim2 of both Convolve and Inverse: the
+ * view is copied to scratch memory, then every line along the axis is transformed
+ * from the copy back into the view.
+ * Parameters:
+ * - data: the view to transform in place
+ * - axis: 0 = rows, 1 = columns, 2 = depth
+ * - kernels: the line kernels of the transform
+ * - lpf, hpf, filter_size: the filters
+ * - workspace: scratch memory and threads, or nullptr to allocate them
+ */
+inline void transform_axis(Array3DView<float> data, int axis, const AxisKernels& kernels,
+                           const float* lpf, const float* hpf, size_t filter_size, DWTWorkspace* workspace) {
+    PROFILE_SCOPE(axis == 0 ? "dim0" : (axis == 1 ? "dim1" : "dim2"), -1, axis);
+
+    // Create a temporary copy of the view to avoid overwriting the original data
+    Array3D<float> local;
+    Array3DView<float> temp = scratch_copy(data, workspace, local);
+
+    // The scratch copy and the kernel each read and write every element once
+    size_t n = axis == 0 ? data.get_rows() : (axis == 1 ? data.get_cols() : data.get_depth());
+    Profiler::add_work(4.0 * sizeof(float) * data.size(), kernel_flops(data.size() / max<size_t>(n, 1), n, filter_size));
+
+    transform_copy(temp, data, axis, kernels, lpf, hpf, filter_size, workspace, false);
+}
+
+/*
+ * Transform along one axis of a view on the calling thread
+ * Used to give each thread whole slices of its own (see DWT::dwt_2d), so the copy goes
+ * to a buffer of that thread's instead of the shared scratch volume.
+ * Parameters:
+ * - data: the view to transform in place
+ * - axis: 0 = rows, 1 = columns, 2 = depth
+ * - kernels: the line kernels of the transform
+ * - lpf, hpf, filter_size: the filters
+ * - scratch: room for a packed copy of the view (data.size() floats)
+ */
+inline void transform_axis_serial(Array3DView<float> data, int axis, const AxisKernels& kernels,
+                                  const float* lpf, const float* hpf, size_t filter_size, float* scratch) {
+    Array3DView<float> temp(scratch, data.get_depth(), data.get_rows(), data.get_cols(),
+                            data.get_rows() * data.get_cols(), data.get_cols());
+    copy_view(data, temp);
+    transform_copy(temp, data, axis, kernels, lpf, hpf, filter_size, nullptr, true);
+}
+
+#endif // AXIS_H
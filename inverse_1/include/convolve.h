@@ -2,24 +2,55 @@
 #define CONVOLVE_H
 
 #include "utilities/utils.h"
+#include "utilities/tiled.h"
+#include "workspace.h"
 #include "filters.h"
+#include "kernels.h"
+#include "axis.h"
 
 class Convolve {
 public:
+
     Convolve(const float* lpf, const float* hpf, size_t filter_size);
 
     void dim0(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const;
     void dim1(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const;
     void dim2(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const;
 
+    // Transform along each dimension over the whole of a (sub-volume) view, in parallel,
+    // drawing scratch memory and threads from the workspace when one is given
+    void dim0(Array3DView<float> data, DWTWorkspace* workspace = nullptr) const;
+    void dim1(Array3DView<float> data, DWTWorkspace* workspace = nullptr) const;
+    void dim2(Array3DView<float> data, DWTWorkspace* workspace = nullptr) const;
+
+    // Transform along an axis (0 = rows, 1 = columns, 2 = depth) of a view on the calling thread,
+    // copying through 'scratch' (room for data.size() floats)
+    void dim_serial(Array3DView<float> data, int axis, float* scratch) const;
+
+    // Get the length of the filters
+    size_t get_filter_size() const { return filter_size; }
+
+    // Get the low-pass and high-pass filters
+    const float* get_lpf() const { return lpf; }
+    const float* get_hpf() const { return hpf; }
+
+    // Transform along an axis (0 = rows, 1 = columns, 2 = depth) of a tiled array
+    void dim(TiledArray3D<float>& data, int axis, size_t depth_limit, size_t row_limit, size_t col_limit, DWTWorkspace* workspace = nullptr) const;
+
 
 private:
-    void convolve(Array3D<float>& data, size_t limit1, size_t limit2, size_t limit3, 
-                        size_t stride1, size_t stride2, size_t stride3, int dimension) const;
+    // Convolve and subsample one contiguous line into its low and high halves
+    void analyze_line(const float* in, size_t n, float* out) const;
+
+    // Transform along an axis (0 = rows, 1 = columns, 2 = depth) of a view; dim0, dim1 and dim2 all go through here
+    void convolve(Array3DView<float> data, int dimension, DWTWorkspace* workspace) const;
 
     const float* lpf;
     const float* hpf;
     size_t filter_size;
+
+    // Line kernels specialised for the filter length, instruction set and line stride, chosen once in the constructor
+    AxisKernels kernels;
 };
 
 #endif // CONVOLVE_H
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include "utilities/utils.h"
+#include "workspace.h"
+#include "inverse.h"
+
+using namespace std;
+
+class DWT;
+
+/*
+ * Wavelet shrinkage denoising
+ * The volume is transformed, every detail coefficient (all but the deepest LLL band)
+ * is soft-thresholded, and the result is transformed back.
+ */
+class Denoise {
+public:
+    // Estimate the universal (VisuShrink) threshold sigma * sqrt(2 ln N) of a transformed volume,
+    // with the noise sigma taken from the median absolute value of the level 1 HHH band
+    static float universal_threshold(Array3DView<const float> coefficients);
+
+    // Shrink every detail coefficient towards zero by the threshold (soft thresholding)
+    static void soft_threshold(Array3DView<float> coefficients, int levels, float threshold, DWTWorkspace* workspace = nullptr);
+
+    /*
+     * Denoise a volume
+     * Parameters:
+     * - dwt, inverse: the forward and inverse transforms of the wavelet
+     * - data: the noisy volume
+     * - result: view to store the denoised volume, of the same dimensions (may be the same as data)
+     * - levels: number of levels of decomposition
+     * - threshold: the threshold to apply; negative to use the universal threshold
+     * - workspace: scratch memory and threads
+     * Returns:
+     * - the threshold that was applied
+     */
+    static float run(const DWT& dwt, const Inverse& inverse, Array3DView<const float> data, Array3DView<float> result,
+                     int levels, float threshold, DWTWorkspace& workspace);
+};
+
+#endif // DENOISE_H
@@ -0,0 +1,43 @@
+#ifndef DICOM_H
+#define DICOM_H
+
+#include "utilities/utils.h"
+#include "utilities/parallel.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+
+using namespace std;
+
+// Header information of a single DICOM slice needed to place it in the volume
+struct DICOMSlice {
+    string filename;
+    size_t rows = 0, cols = 0;
+    unsigned bits_allocated = 0;
+    unsigned pixel_representation = 0; // 0 = unsigned, 1 = signed
+    unsigned samples_per_pixel = 1;
+    double position[3] = {0.0, 0.0, 0.0};
+    double orientation[6] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+    bool has_position = false;
+    long instance_number = 0;
+    streamoff pixel_offset = -1; // byte offset of the pixel data in the file
+    size_t pixel_length = 0;
+};
+
+// Reader for uncompressed DICOM series (one slice per .dcm file)
+class DICOM {
+public:
+    // Read every .dcm file in a directory into a 3D array ordered by slice position
+    static Array3D<float> read_series(const string& directory);
+
+    // Parse the header of a single slice, stopping at the pixel data
+    static DICOMSlice read_header(const string& filename);
+
+private:
+    // Decode the pixel data of a slice into the given depth of the volume
+    static void read_pixels(const DICOMSlice& slice, Array3D<float>& data, size_t depth, vector<char>& buffer);
+};
+
+#endif // DICOM_H
@@ -2,46 +2,82 @@
 #define FILTERS_H
 
 #include <iostream>
+#include <array>
+#include <string>
+#include <vector>
 
 using namespace std;
 
-// Filter Definitions
+// Analysis (lpf/hpf, used by Convolve) and synthesis (Ilpf/Ihpf, used by Inverse) filters of a wavelet
+template <size_t N>
+struct FilterBank {
+    array<float, N> lpf, hpf, Ilpf, Ihpf;
+};
 
-extern float DB1_L[2];
-extern float DB1_H[2];
+/*
+ * Derive the filter bank of an orthogonal wavelet (dbN, symN, coifN) at compile time
+ * The high-pass filter is the alternating flip of the low-pass filter, and the
+ * synthesis filters are the same as the analysis filters.
+ * Parameters:
+ * - lo: the low-pass filter (PyWavelets rec_lo)
+ */
+template <size_t N>
+constexpr FilterBank<N> orthogonal(const double (&lo)[N]) {
+    FilterBank<N> bank{};
+    for (size_t k = 0; k < N; ++k) {
+        bank.lpf[k] = static_cast<float>(lo[k]);
+        bank.hpf[k] = static_cast<float>(k % 2 == 0 ? lo[N - 1 - k] : -lo[N - 1 - k]);
+        bank.Ilpf[k] = bank.lpf[k];
+        bank.Ihpf[k] = bank.hpf[k];
+    }
+    return bank;
+}
 
-extern float DB2_L[4];
-extern float DB2_H[4];
-extern float DB2_I_L[4];
-extern float DB2_I_H[4];
+/*
+ * Derive the filter bank of a biorthogonal wavelet (biorN.M) at compile time
+ * The analysis filters are the reversed decomposition filters (the convolution runs
+ * forwards over the signal) and the high-pass filters are the alternating-sign
+ * modulations of the opposite low-pass filters.
+ * Parameters:
+ * - dec_lo: the decomposition low-pass filter (PyWavelets dec_lo)
+ * - rec_lo: the reconstruction low-pass filter (PyWavelets rec_lo)
+ */
+template <size_t N>
+constexpr FilterBank<N> biorthogonal(const double (&dec_lo)[N], const double (&rec_lo)[N]) {
+    FilterBank<N> bank{};
+    for (size_t k = 0; k < N; ++k) {
+        size_t r = N - 1 - k;
+        bank.lpf[k] = static_cast<float>(dec_lo[r]);
+        bank.hpf[k] = static_cast<float>(r % 2 == 0 ? rec_lo[r] : -rec_lo[r]);
+        bank.Ilpf[k] = static_cast<float>(rec_lo[k]);
+        bank.Ihpf[k] = static_cast<float>(k % 2 == 0 ? -dec_lo[k] : dec_lo[k]);
+    }
+    return bank;
+}
 
-extern float DB3_L[6];
-extern float DB3_H[6];
-extern float DB3_I_L[6];
-extern float DB3_I_H[6];
+// Entry of the filter registry: a wavelet name and pointers into its filter bank
+struct FilterInfo {
+    const char* name;
+    size_t size;
+    const float* lpf;
+    const float* hpf;
+    const float* Ilpf;
+    const float* Ihpf;
+};
 
-extern float DB4_L[8];
-extern float DB4_H[8];
-extern float DB4_I_L[8];
-extern float DB4_I_H[8];
+// Make a registry entry for a filter bank with static storage
+template <size_t N>
+constexpr FilterInfo filter_entry(const char* name, const FilterBank<N>& bank) {
+    return FilterInfo{name, N, bank.lpf.data(), bank.hpf.data(), bank.Ilpf.data(), bank.Ihpf.data()};
+}
 
-extern float DB5_L[10];
-extern float DB5_H[10];
+// Look up a wavelet in the registry (nullptr if there is no such wavelet)
+const FilterInfo* find_filter(const string& filter_type);
 
-extern float DB6_L[12];
-extern float DB6_H[12];
-
-extern float DB7_L[14];
-extern float DB7_H[14];
-extern float DB7_I_L[14];
-extern float DB7_I_H[14];
-
-extern float DB8_L[16];
-extern float DB8_H[16];
-extern float DB8_I_L[16];
-extern float DB8_I_H[16];
+// Get the names of all the wavelets in the registry
+vector<string> filter_names();
 
 // Function to get the filter coefficients based on the filter type
 bool get_filters(const string& filter_type, const float*& lpf, const float*& hpf, const float*& Ilpf, const float*& Ihpf, size_t& filter_size);
 
-#endif // FILTERS_H
\ No newline at end of file
+#endif // FILTERS_H
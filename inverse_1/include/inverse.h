@@ -2,24 +2,73 @@
 #define INVERSE_H
 
 #include "utilities/utils.h"
+#include "utilities/tiled.h"
+#include "workspace.h"
 #include "utilities/jbutil.h"
 #include "filters.h"
+#include "kernels.h"
+#include "axis.h"
+#include "levels.h"
 
 class Inverse {
 public:
+
     Inverse(const float* lpf, const float* hpf, size_t filter_size);
 
     void dim0(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const;
     void dim1(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const;
     void dim2(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const;
 
-    Array3D<float> inverse_dwt_3d(const Array3D<float>& data, int levels) const;
+    // Transform along each dimension over the whole of a (sub-volume) view, in parallel,
+    // drawing scratch memory and threads from the workspace when one is given
+    void dim0(Array3DView<float> data, DWTWorkspace* workspace = nullptr) const;
+    void dim1(Array3DView<float> data, DWTWorkspace* workspace = nullptr) const;
+    void dim2(Array3DView<float> data, DWTWorkspace* workspace = nullptr) const;
+
+    // Transform along an axis (0 = rows, 1 = columns, 2 = depth) of a view on the calling thread,
+    // copying through 'scratch' (room for data.size() floats)
+    void dim_serial(Array3DView<float> data, int axis, float* scratch) const;
+
+    // Get the length of the filters
+    size_t get_filter_size() const { return filter_size; }
+
+    // Transform along an axis (0 = rows, 1 = columns, 2 = depth) of a tiled array
+    void dim(TiledArray3D<float>& data, int axis, size_t depth_limit, size_t row_limit, size_t col_limit, DWTWorkspace* workspace = nullptr) const;
+
+    Array3D<float> inverse_dwt_3d(const Array3D<float>& data, const AxisLevels& levels) const;
+
+    // Perform the inverse transform into a caller-owned result using the workspace for scratch
+    void inverse_dwt_3d(const Array3D<float>& data, Array3D<float>& result, const AxisLevels& levels, DWTWorkspace& workspace) const;
+
+    // Perform the inverse transform between views of caller-owned memory with any strides (in place if they are the same)
+    void inverse_dwt_3d(Array3DView<const float> data, Array3DView<float> result, const AxisLevels& levels, DWTWorkspace& workspace) const;
+
+    // Perform the inverse transform in place on a tiled array
+    void inverse_dwt_3d(TiledArray3D<float>& data, const AxisLevels& levels, DWTWorkspace* workspace = nullptr) const;
+
+    // Perform the inverse transform of coefficients laid out by dwt_3d with the compact layout
+    // (each deeper level reconstructed in a packed buffer of its own, see DWT::dwt_3d_compact)
+    void inverse_dwt_3d_compact(Array3DView<const float> data, Array3DView<float> result, const AxisLevels& levels, DWTWorkspace& workspace) const;
+
+    // Perform the inverse of DWT::dwt_2d, slice by slice in parallel (line by line with fewer slices than threads)
+    void inverse_dwt_2d(Array3DView<const float> data, Array3DView<float> result, int levels, DWTWorkspace& workspace) const;
 
 private:
+    // Upsample and combine the low and high halves of one contiguous line
+    void synthesize_line(const float* in, size_t n, float* out) const;
+
+    // Undo one level within its bounds along the axes that the level split
+    void inverse_level(Array3DView<float> bounds, const AxisLevels& levels, int level, DWTWorkspace* workspace) const;
+
+    // Transform along an axis (0 = rows, 1 = columns, 2 = depth) of a view; dim0, dim1 and dim2 all go through here
+    void convolve(Array3DView<float> data, int dimension, DWTWorkspace* workspace) const;
+
     const float* lpf;
     const float* hpf;
     size_t filter_size;
 
+    // Line kernels specialised for the filter length, instruction set and line stride, chosen once in the constructor
+    AxisKernels kernels;
 };
 
 #endif // INVERSE_H
\ No newline at end of file
@@ -2,29 +2,75 @@
 #define IO_H
 
 #include "utilities/utils.h"
+#include "utilities/convert.h"
+#include "utilities/profiler.h"
+#include "levels.h"
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <cctype>
+#include <type_traits>
 
 using namespace std;
 
+// Index entry describing one subband in a multi-level export
+struct SubbandRecord {
+    uint32_t level;      // decomposition level (1 = finest)
+    char tag[4];         // subband name, e.g. "LLH" (null terminated)
+    uint64_t offset;     // byte offset of the coefficients from the start of the file
+    uint64_t depth, rows, cols; // dimensions of the subband
+};
+
 class IO {
 public:
     // Read the data from a binary file and return it as a 3D array
-    static Array3D<float> read(const string& filename, const string& shape_filename);
+    // (dtype is float32, int16 or uint16; empty uses the shape file, defaulting to float32)
+    static Array3D<float> read(const string& filename, const string& shape_filename, const string& dtype = "");
 
     // Export the data to a binary file
-    static void export_data(const Array3D<float>& data, const string& filename);
+    static void export_data(Array3DView<const float> data, const string& filename);
+
+    // Export every subband of every level as an indexed record
+    static void export_subbands(Array3DView<const float> data, const string& filename, const AxisLevels& levels);
+
+    // Read the index of a file written by export_subbands
+    static vector<SubbandRecord> read_subband_index(const string& filename);
 
     // Construct filenames based on input parameters
-    static tuple<string, string, string> construct_filenames(const string& file_number, const string& dataset_type, const string& mr_type, const string& phase_type, const string& filter_type, int levels);
+    static tuple<string, string, string> construct_filenames(const string& file_number, const string& dataset_type, const string& mr_type, const string& phase_type, const string& filter_type, const AxisLevels& levels);
+
+    static bool export_inverse(Array3DView<const float> data, const std::string& filename);
+
+    // Read the shape information (and optional dtype) from a shape file
+    static vector<size_t> read_shape(const string& shape_filename, string& dtype);
 
-    static bool export_inverse(const Array3D<float>& data, const std::string& filename);
+    // Read a binary PGM or PPM image (via jbutil::image) as one slice per channel, with the raw pixel values
+    static Array3D<float> read_image(const string& filename, int& maxval);
+
+    // Write one or three slices as a PGM or PPM image, rounding and clamping the values to [0, maxval]
+    static void export_image(Array3DView<const float> data, const string& filename, int maxval);
+
+    // Read frame t of a binary file of equally sized frames into a sized array (dtype as for read)
+    static void read_frame(const string& filename, size_t t, const string& dtype, Array3D<float>& frame);
+
+    // Create (or truncate) a float32 file of 'frames' frames of 'frame_elements' values each, filled with zeros
+    static void create_series(const string& filename, size_t frames, size_t frame_elements);
+
+    // Write frame t of a file made by create_series, in place
+    static void export_frame(Array3DView<const float> frame, const string& filename, size_t t);
 
 private:
-    // Read the shape information from a shape file
-    static vector<size_t> read_shape(const string& shape_filename);
+    // Write the elements of a view to an open file, row by row
+    static void write_view(ostream& file, Array3DView<const float> data);
+
+    // Read 16-bit samples in chunks and widen them to float while filling the array
+    template <class S>
+    static void read_widened(ifstream& file, Array3D<float>& data, const string& filename);
 };
 
 #endif // IO_H
\ No newline at end of file
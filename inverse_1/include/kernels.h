@@ -0,0 +1,73 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+// Instruction sets that the line kernels are compiled for
+enum class ISA {
+    SSE2,  // x86-64 baseline
+    AVX2,
+    AVX512
+};
+
+/*
+ * Line kernel of the forward (analysis) or inverse (synthesis) transform
+ * Parameters:
+ * - in, in_stride: the first element of the input line and the distance between its elements
+ * - out, out_stride: the same for the output line
+ * - n: number of elements in the line
+ * - lpf, hpf, filter_size: the filters
+ */
+typedef void (*LineKernel)(const float* in, ptrdiff_t in_stride, float* out, ptrdiff_t out_stride, size_t n,
+                           const float* lpf, const float* hpf, size_t filter_size);
+
+// Get the best instruction set supported by this CPU (from cpuid)
+ISA detect_isa();
+
+// Get the instruction set used for the kernels: the override if one is set, otherwise the detected one
+ISA active_isa();
+
+// Override the instruction set ("auto", "sse2", "avx2" or "avx512"); throws if the CPU does not support it.
+// The DWT_ISA environment variable sets the initial override.
+void set_isa(const string& name);
+
+// Get the name of an instruction set
+const char* isa_name(ISA isa);
+
+// Get the kernel for a filter length, compiled for the active instruction set; the
+// contiguous version ignores the strides it is given and assumes unit-stride lines
+LineKernel analysis_kernel(size_t filter_size, bool contiguous = false);
+LineKernel synthesis_kernel(size_t filter_size, bool contiguous = false);
+
+/*
+ * Count the floating-point operations of a kernel over a block of lines
+ * Both kernels do 2 multiplies and 2 adds per filter tap for each low/high pair.
+ * Parameters:
+ * - lines: number of lines
+ * - n: number of elements in each line
+ * - filter_size: number of filter taps
+ */
+inline double kernel_flops(size_t lines, size_t n, size_t filter_size) {
+    return 4.0 * filter_size * (n / 2) * lines;
+}
+
+// Kernels compiled for each instruction set (src/kernels_<isa>.cpp)
+namespace sse2 {
+    LineKernel analysis_kernel(size_t filter_size, bool contiguous);
+    LineKernel synthesis_kernel(size_t filter_size, bool contiguous);
+}
+
+namespace avx2 {
+    LineKernel analysis_kernel(size_t filter_size, bool contiguous);
+    LineKernel synthesis_kernel(size_t filter_size, bool contiguous);
+}
+
+namespace avx512 {
+    LineKernel analysis_kernel(size_t filter_size, bool contiguous);
+    LineKernel synthesis_kernel(size_t filter_size, bool contiguous);
+}
+
+#endif // KERNELS_H
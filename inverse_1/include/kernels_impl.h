@@ -0,0 +1,162 @@
+// Line kernels, compiled once per instruction set by src/kernels_<isa>.cpp, each of which
+// defines KERNEL_ISA as the namespace to put them in. Only include this header there, and
+// keep it free of library calls, so that no inline function compiled for one instruction
+// set can be linked into code running on a CPU without it.
+
+#ifndef KERNEL_ISA
+#error "KERNEL_ISA must be defined before including kernels_impl.h"
+#endif
+
+#include "kernels.h"
+
+namespace KERNEL_ISA {
+
+/* 
+ * Convolve and subsample one strided line into its low and high halves
+ * The filter length N is a template parameter so that the filter loop is unrolled;
+ * N = 0 is the generic version, which uses the filter_size given at run time.
+ * With Contiguous set the strides are taken to be 1 at compile time, so the
+ * loads and stores of lines along the columns are unit-stride.
+ * Parameters:
+ * - in, in_stride: the first element of the input line and the distance between its elements
+ * - out, out_stride: the same for the output line (low-pass half first, then the high-pass half)
+ * - n: number of elements in the line
+ * - lpf, hpf, filter_size: the analysis filters
+ */
+template <size_t N, bool Contiguous>
+void analyze(const float* in, ptrdiff_t line_in_stride, float* out, ptrdiff_t line_out_stride, size_t n,
+             const float* lpf, const float* hpf, size_t filter_size) {
+    const ptrdiff_t in_stride = Contiguous ? 1 : line_in_stride;
+    const ptrdiff_t out_stride = Contiguous ? 1 : line_out_stride;
+    const size_t taps = N ? N : filter_size;
+    const size_t half = n / 2;
+    const size_t even = 2 * half; // an odd last element is left out, so that it passes through
+
+    // Outputs whose filter window lies inside the line do not need to wrap around
+    size_t interior = even >= taps ? (even - taps) / 2 + 1 : 0;
+
+    for (size_t i = 0; i < interior; ++i) {
+        const float* x = in + static_cast<ptrdiff_t>(2 * i) * in_stride;
+        float sum_low = 0.0f;  // Sum for low-pass filter
+        float sum_high = 0.0f; // Sum for high-pass filter
+
+        for (size_t j = 0; j < taps; ++j) {
+            float input_val = x[static_cast<ptrdiff_t>(j) * in_stride];
+            sum_low += lpf[j] * input_val;
+            sum_high += hpf[j] * input_val;
+        }
+
+        out[static_cast<ptrdiff_t>(i) * out_stride] = sum_low;
+        out[static_cast<ptrdiff_t>(i + half) * out_stride] = sum_high;
+    }
+
+    // The last outputs wrap around to the start of the even part of the line
+    for (size_t i = interior; i < half; ++i) {
+        float sum_low = 0.0f;
+        float sum_high = 0.0f;
+
+        for (size_t j = 0; j < taps; ++j) {
+            float input_val = in[static_cast<ptrdiff_t>((2 * i + j) % even) * in_stride];
+            sum_low += lpf[j] * input_val;
+            sum_high += hpf[j] * input_val;
+        }
+
+        out[static_cast<ptrdiff_t>(i) * out_stride] = sum_low;
+        out[static_cast<ptrdiff_t>(i + half) * out_stride] = sum_high;
+    }
+}
+
+/* 
+ * Upsample and combine the low and high halves of one strided line
+ * The filter length N is a template parameter so that the filter loop is unrolled;
+ * N = 0 is the generic version, which uses the filter_size given at run time.
+ * Contiguous fixes both strides at 1, as for analyze.
+ * The last pairs wrap around to the start of the even part of the line, as the last
+ * outputs of analyze do, so every line is reconstructed exactly. An odd last element
+ * passes through, as analyze leaves it out of the filter windows.
+ * Parameters:
+ * - in, in_stride: the first element of the input line (low half, then high half) and the distance between its elements
+ * - out, out_stride: the same for the reconstructed line
+ * - n: number of elements in the line
+ * - lpf, hpf, filter_size: the synthesis filters
+ */
+template <size_t N, bool Contiguous>
+void synthesize(const float* in, ptrdiff_t line_in_stride, float* out, ptrdiff_t line_out_stride, size_t n,
+                const float* lpf, const float* hpf, size_t filter_size) {
+    const ptrdiff_t in_stride = Contiguous ? 1 : line_in_stride;
+    const ptrdiff_t out_stride = Contiguous ? 1 : line_out_stride;
+    const size_t taps = N ? N : filter_size;
+    const size_t half = n / 2;
+    const size_t even = 2 * half;
+
+    for (size_t i = 0; i < even; ++i) {
+        out[static_cast<ptrdiff_t>(i) * out_stride] = 0.0f; // Initialize the output line to zero
+    }
+    if (n % 2 != 0) {
+        out[static_cast<ptrdiff_t>(n - 1) * out_stride] = in[static_cast<ptrdiff_t>(n - 1) * in_stride];
+    }
+
+    // Inputs whose filter window lies inside the line need no wrap-around
+    size_t interior = even >= taps ? (even - taps) / 2 + 1 : 0;
+
+    for (size_t i = 0; i < half; ++i) {
+        float low_val = in[static_cast<ptrdiff_t>(i) * in_stride];
+        float high_val = in[static_cast<ptrdiff_t>(i + half) * in_stride];
+
+        if (i < interior) {
+            float* y = out + static_cast<ptrdiff_t>(2 * i) * out_stride;
+            for (size_t j = 0; j < taps; ++j) {
+                y[static_cast<ptrdiff_t>(j) * out_stride] += (lpf[j] * low_val) + (hpf[j] * high_val);
+            }
+        } else {
+            for (size_t j = 0; j < taps; ++j) {
+                size_t k = (2 * i + j) % even;
+                out[static_cast<ptrdiff_t>(k) * out_stride] += (lpf[j] * low_val) + (hpf[j] * high_val);
+            }
+        }
+    }
+}
+
+// Choose the analysis kernel instantiated for a filter length, or the generic one
+template <bool Contiguous>
+LineKernel analysis_kernel_for(size_t filter_size) {
+    switch (filter_size) {
+        case 2: return analyze<2, Contiguous>;
+        case 4: return analyze<4, Contiguous>;
+        case 6: return analyze<6, Contiguous>;
+        case 8: return analyze<8, Contiguous>;
+        case 10: return analyze<10, Contiguous>;
+        case 12: return analyze<12, Contiguous>;
+        case 14: return analyze<14, Contiguous>;
+        case 16: return analyze<16, Contiguous>;
+        case 18: return analyze<18, Contiguous>;
+        default: return analyze<0, Contiguous>;
+    }
+}
+
+// Choose the synthesis kernel instantiated for a filter length, or the generic one
+template <bool Contiguous>
+LineKernel synthesis_kernel_for(size_t filter_size) {
+    switch (filter_size) {
+        case 2: return synthesize<2, Contiguous>;
+        case 4: return synthesize<4, Contiguous>;
+        case 6: return synthesize<6, Contiguous>;
+        case 8: return synthesize<8, Contiguous>;
+        case 10: return synthesize<10, Contiguous>;
+        case 12: return synthesize<12, Contiguous>;
+        case 14: return synthesize<14, Contiguous>;
+        case 16: return synthesize<16, Contiguous>;
+        case 18: return synthesize<18, Contiguous>;
+        default: return synthesize<0, Contiguous>;
+    }
+}
+
+LineKernel analysis_kernel(size_t filter_size, bool contiguous) {
+    return contiguous ? analysis_kernel_for<true>(filter_size) : analysis_kernel_for<false>(filter_size);
+}
+
+LineKernel synthesis_kernel(size_t filter_size, bool contiguous) {
+    return contiguous ? synthesis_kernel_for<true>(filter_size) : synthesis_kernel_for<false>(filter_size);
+}
+
+} // namespace KERNEL_ISA
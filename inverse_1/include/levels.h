@@ -0,0 +1,142 @@
+#ifndef LEVELS_H
+#define LEVELS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Number of levels of decomposition along each axis
+ * Volumes with far fewer slices than in-plane pixels run out of depth after a couple
+ * of levels, so each axis has its own count: at level i (from 0) the passes along an
+ * axis run only while i is below its count, and its bounds stop halving after that.
+ * A single count (the implicit conversion from int) gives the usual isotropic transform.
+ */
+struct AxisLevels {
+    int rows, cols, depth;
+
+    // The same number of levels along every axis
+    AxisLevels(int levels = 1) : rows(levels), cols(levels), depth(levels) {}
+
+    // Separate numbers of levels along the rows, columns and depth
+    AxisLevels(int rows, int cols, int depth) : rows(rows), cols(cols), depth(depth) {}
+
+    // Get the number of levels of the deepest axis (the number of levels the transform runs)
+    int max() const { return std::max(rows, std::max(cols, depth)); }
+
+    // Check whether every axis has the same number of levels
+    bool uniform() const { return rows == cols && cols == depth; }
+
+    // Check whether an axis (0 = rows, 1 = columns, 2 = depth) is transformed at a level (from 0)
+    bool splits(int axis, int level) const { return level < (axis == 0 ? rows : (axis == 1 ? cols : depth)); }
+
+    // Get the counts as text: "4" if uniform, otherwise e.g. "4,4,2" (rows, columns, depth)
+    string name(char separator = ',') const {
+        if (uniform()) {
+            return to_string(rows);
+        }
+        return to_string(rows) + separator + to_string(cols) + separator + to_string(depth);
+    }
+
+    /*
+     * Parse a number of levels, or a list of one per axis
+     * Parameters:
+     * - text: "N" for N levels along every axis, or "R,C,D" for the rows, columns and depth
+     * Throws if the counts are malformed, negative or all zero.
+     */
+    static AxisLevels parse(const string& text) {
+        vector<int> counts;
+        stringstream ss(text);
+        string item;
+        while (getline(ss, item, ',')) {
+            size_t used = 0;
+            int count = stoi(item, &used);
+            if (used != item.size() || count < 0) {
+                throw invalid_argument("Invalid number of levels: " + text);
+            }
+            counts.push_back(count);
+        }
+        if (counts.size() != 1 && counts.size() != 3) {
+            throw invalid_argument("Levels must be one number or one per axis (rows,cols,depth): " + text);
+        }
+        AxisLevels levels = counts.size() == 1 ? AxisLevels(counts[0]) : AxisLevels(counts[0], counts[1], counts[2]);
+        if (levels.max() < 1) {
+            throw invalid_argument("At least one axis needs a level: " + text);
+        }
+        return levels;
+    }
+};
+
+/*
+ * Calculate the bounds of the region transformed at each level
+ * An axis halves (rounding up) after every level that splits it and keeps its extent after that.
+ * Parameters:
+ * - depth, rows, cols: dimensions of the volume
+ * - levels: the levels along each axis
+ * - depth_levels, row_levels, col_levels: receive the bounds of levels 0 to levels.max() - 1
+ */
+inline void level_bounds(size_t depth, size_t rows, size_t cols, const AxisLevels& levels,
+                         vector<size_t>& depth_levels, vector<size_t>& row_levels, vector<size_t>& col_levels) {
+    depth_levels.assign(1, depth);
+    row_levels.assign(1, rows);
+    col_levels.assign(1, cols);
+
+    for (int i = 1; i < levels.max(); ++i) {
+        depth_levels.push_back(levels.splits(2, i - 1) ? (depth_levels[i-1] + 1) / 2 : depth_levels[i-1]);
+        row_levels.push_back(levels.splits(0, i - 1) ? (row_levels[i-1] + 1) / 2 : row_levels[i-1]);
+        col_levels.push_back(levels.splits(1, i - 1) ? (col_levels[i-1] + 1) / 2 : col_levels[i-1]);
+    }
+}
+
+// Position and size of one subband of a transform, as laid out by subband_layout
+struct SubbandLayout {
+    int level;             // decomposition level (1 = finest)
+    const char* tag;       // subband name, e.g. "LLH" (depth, rows, columns; L = low, H = high)
+    size_t origin[3];      // depth, row and column of the first coefficient
+    size_t depth, rows, cols;
+};
+
+/*
+ * List the subbands of a transform, coarsest level first
+ * For each level from the deepest, the LLL band (deepest level only) and then the detail
+ * bands of the axes the level splits, in the order LLH, LHL, ... HHH. An axis the level
+ * does not split has only a low band, covering its whole extent at that level. This is
+ * the order of the subband files (IO::export_subbands) and of the subband statistics.
+ * Parameters:
+ * - depth, rows, cols: dimensions of the volume
+ * - levels: the levels along each axis
+ * Returns:
+ * - the subbands, in order
+ */
+inline vector<SubbandLayout> subband_layout(size_t depth, size_t rows, size_t cols, const AxisLevels& levels) {
+    vector<size_t> depth_levels, row_levels, col_levels;
+    level_bounds(depth, rows, cols, levels, depth_levels, row_levels, col_levels);
+
+    static const char* tags[8] = {"LLL", "LLH", "LHL", "LHH", "HLL", "HLH", "HHL", "HHH"};
+    vector<SubbandLayout> bands;
+    for (int level = levels.max(); level >= 1; --level) {
+        bool split_depth = levels.splits(2, level - 1);
+        bool split_rows = levels.splits(0, level - 1);
+        bool split_cols = levels.splits(1, level - 1);
+        size_t sub_depth = split_depth ? depth_levels[level-1] / 2 : depth_levels[level-1];
+        size_t sub_rows = split_rows ? row_levels[level-1] / 2 : row_levels[level-1];
+        size_t sub_cols = split_cols ? col_levels[level-1] / 2 : col_levels[level-1];
+
+        for (int band = (level == levels.max() ? 0 : 1); band < 8; ++band) {
+            if (((band & 4) && !split_depth) || ((band & 2) && !split_rows) || ((band & 1) && !split_cols)) {
+                continue;
+            }
+            bands.push_back({level, tags[band],
+                             {(band & 4) ? sub_depth : 0, (band & 2) ? sub_rows : 0, (band & 1) ? sub_cols : 0},
+                             sub_depth, sub_rows, sub_cols});
+        }
+    }
+    return bands;
+}
+
+#endif // LEVELS_H
@@ -0,0 +1,92 @@
+#ifndef LIBDWT_H
+#define LIBDWT_H
+
+/*
+ * C interface of libdwt, the shared-library build of the 3D wavelet transform
+ * Volumes are caller-owned float buffers described by their dimensions (depth, rows,
+ * cols) and strides in elements along each of them, so C-order, Fortran-order and
+ * sliced NumPy arrays are used where they are, without copies. Functions return 0 on
+ * success and -1 on error, with the message available from dwt_last_error.
+ * A context may be used by one thread at a time; use one context per thread.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define DWT_EXPORT __declspec(dllexport)
+#else
+#define DWT_EXPORT __attribute__((visibility("default")))
+#endif
+
+// Version of this interface; incremented when a function changes
+#define DWT_API_VERSION 1
+
+// Wavelet transforms of one filter, with their thread pool and scratch memory
+typedef struct dwt_context dwt_context;
+
+// Get the version of the interface the library was built with
+DWT_EXPORT int dwt_api_version(void);
+
+// Get the message of the last error on the calling thread (empty if none)
+DWT_EXPORT const char* dwt_last_error(void);
+
+// Create a context for a filter from the registry (e.g. "db4"), using 'threads' worker threads
+// (0 for the default: DWT_THREADS or the hardware count); returns NULL on error
+DWT_EXPORT dwt_context* dwt_create(const char* filter, size_t threads);
+
+// Release a context and its memory
+DWT_EXPORT void dwt_destroy(dwt_context* context);
+
+/*
+ * Forward transform
+ * Parameters:
+ * - context: the context of the filter
+ * - input, input_strides: the volume and its strides in elements (depth, rows, cols)
+ * - output, output_strides: the buffer for the coefficients and its strides; it may be
+ *   the input buffer with the same strides to transform in place
+ * - dims: depth, rows and cols of the volume
+ * - levels: number of levels of decomposition
+ */
+DWT_EXPORT int dwt_forward(dwt_context* context, const float* input, const ptrdiff_t input_strides[3],
+                           float* output, const ptrdiff_t output_strides[3], const size_t dims[3], int levels);
+
+// Inverse transform of coefficients laid out by dwt_forward (same parameters)
+DWT_EXPORT int dwt_inverse(dwt_context* context, const float* input, const ptrdiff_t input_strides[3],
+                           float* output, const ptrdiff_t output_strides[3], const size_t dims[3], int levels);
+
+/*
+ * Update the coefficients of dwt_forward after some depth slices of the volume changed,
+ * transforming only the change (work proportional to the changed slices, not the volume)
+ * Parameters:
+ * - context: the context of the filter
+ * - previous, previous_strides: the changed slices before the change (changed_count x rows x cols) and their strides
+ * - current, current_strides: the same slices after the change
+ * - coefficients, coefficient_strides: the coefficients of the volume before the change, updated in place
+ * - dims: depth, rows and cols of the volume
+ * - levels: number of levels the coefficients were made with
+ * - changed, changed_count: the depth index of each changed slice
+ */
+DWT_EXPORT int dwt_update(dwt_context* context, const float* previous, const ptrdiff_t previous_strides[3],
+                          const float* current, const ptrdiff_t current_strides[3],
+                          float* coefficients, const ptrdiff_t coefficient_strides[3], const size_t dims[3], int levels,
+                          const size_t* changed, size_t changed_count);
+
+/*
+ * Wavelet shrinkage denoising: forward transform, soft thresholding of the detail bands, inverse
+ * The parameters are as for dwt_forward, plus:
+ * - threshold: the threshold to apply; negative to use the universal threshold
+ * - applied: if not NULL, receives the threshold that was applied
+ */
+DWT_EXPORT int dwt_denoise(dwt_context* context, const float* input, const ptrdiff_t input_strides[3],
+                           float* output, const ptrdiff_t output_strides[3], const size_t dims[3], int levels,
+                           float threshold, float* applied);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBDWT_H
@@ -0,0 +1,106 @@
+#ifndef SERIES_H
+#define SERIES_H
+
+#include "DWT.h"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * 4D (3D + time) wavelet transform of a series of volumes
+ * Each frame is transformed in 3D as by DWT::dwt_3d, and the frames are then transformed
+ * along time, with the same filter and the same layout (low frames first, then high) as
+ * the other axes. The temporal levels form a cascade of rolling windows: a level holds
+ * only the frames under its filter support (plus the first few, for the periodic
+ * wrap-around), and passes each low frame on to the next level as soon as it is made,
+ * so memory stays bounded by the filter length, not the length of the series.
+ * Frames are read and written through callbacks, in any order the caller's storage allows
+ * (the inverse writes the series starting part of the way through, see SeriesDWT::pull).
+ */
+class SeriesDWT {
+public:
+    // Read frame t of a series into a volume (resized by the callback)
+    typedef function<void(size_t t, Array3D<float>& frame)> FrameReader;
+
+    // Write frame t of a series
+    typedef function<void(size_t t, Array3DView<const float> frame)> FrameWriter;
+
+    SeriesDWT(const FilterInfo& filter, DWTWorkspace& workspace);
+
+    // Get the number of temporal levels a series of 'frames' frames allows (every level needs an even length)
+    static int max_time_levels(size_t frames);
+
+    /*
+     * Forward transform
+     * Parameters:
+     * - frames: number of frames in the series
+     * - read: reads a frame of the input series
+     * - write: writes a frame of the coefficients (each position is written once)
+     * - levels: spatial levels of each frame
+     * - time_levels: temporal levels (at most max_time_levels(frames))
+     */
+    void forward(size_t frames, const FrameReader& read, const FrameWriter& write, const AxisLevels& levels, int time_levels) const;
+
+    // Inverse transform of coefficients written by forward (same parameters, with read giving coefficient frames)
+    void inverse(size_t frames, const FrameReader& read, const FrameWriter& write, const AxisLevels& levels, int time_levels) const;
+
+private:
+    typedef shared_ptr<Array3D<float>> Frame;
+
+    // Frames of one temporal level of the forward transform
+    struct ForwardStage {
+        size_t length;          // number of frames in the level
+        size_t received = 0;    // frames received so far
+        size_t next_pair = 0;   // next low/high pair to make
+        size_t base = 0;        // index of the first frame in the window
+        deque<Frame> window;    // frames base to received - 1
+        vector<Frame> start;    // the first taps - 2 frames, used again by the pairs that wrap around
+    };
+
+    // Frames of one temporal level of the inverse transform
+    struct InverseStage {
+        size_t length;          // number of frames in the level
+        size_t first_pair = 0;  // pair the level starts from (the first low frame the level below hands on)
+        size_t first_frame = 0; // frame the level hands on first
+        size_t pairs_added = 0; // pairs added in so far
+        size_t handed_on = 0;   // frames handed on so far
+        vector<Frame> frames;   // frames being reconstructed, by index (empty before the first pair and after handing on)
+        vector<size_t> added;   // pairs added into each frame
+    };
+
+    // Pass frame 'received' of a level into its window and make every pair it completes
+    void push(vector<ForwardStage>& stages, size_t level, Frame frame, const FrameWriter& write) const;
+
+    // Get the next reconstructed frame of a level, pulling low frames from the level below it
+    Frame pull(vector<InverseStage>& stages, size_t level, const FrameReader& read) const;
+
+    // Convolve and subsample along time: low = sum of lpf[j] * frames[j], high likewise with hpf
+    void analyze_frames(const vector<const Array3D<float>*>& frames, Array3D<float>& low, Array3D<float>& high) const;
+
+    // Upsample and combine along time: outputs[j] += Ilpf[j] * low + Ihpf[j] * high
+    void synthesize_frames(const Array3D<float>& low, const Array3D<float>& high, const vector<Array3D<float>*>& outputs) const;
+
+    const FilterInfo& filter;
+    DWT dwt;
+    Inverse inverse_dwt;
+    DWTWorkspace& workspace;
+};
+
+/*
+ * Transform a series stored as one binary file of frames (shape file "frames,depth,rows,cols"),
+ * write the coefficients and the reconstruction, and report the time and peak memory
+ * Parameters:
+ * - binary_filename, shape_filename: the input series
+ * - output_filename: the file to write the coefficients to
+ * - filter_type: the wavelet
+ * - levels: spatial levels of each frame
+ * - options: settings of the transform, including the temporal levels
+ */
+void perform_series_transform(const string& binary_filename, const string& shape_filename, const string& output_filename,
+                              const string& filter_type, const AxisLevels& levels, const TransformOptions& options);
+
+#endif // SERIES_H
@@ -0,0 +1,94 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "utilities/utils.h"
+#include "workspace.h"
+#include "DWT.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+/*
+ * Binary protocol of the transform service (all fields little endian)
+ * A client sends any number of requests on one connection. Each request is a
+ * RequestHeader, then output_length bytes of output path (optional), then
+ * depth * rows * cols float32 samples in row-major order. Each request is answered
+ * with a ResponseHeader followed by payload_bytes bytes: the result samples when no
+ * output path was given, nothing when the result was written to the path, or the
+ * error message when status is not zero.
+ */
+enum class JobType : uint32_t {
+    Transform = 1, // forward transform
+    Inverse = 2,   // inverse transform of a transformed volume
+    Denoise = 3    // forward transform, soft thresholding and inverse
+};
+
+struct RequestHeader {
+    char magic[4];          // "DWTQ"
+    uint32_t version;       // 1
+    uint32_t job;           // JobType
+    uint32_t levels;        // number of levels of decomposition
+    uint64_t depth, rows, cols;
+    char filter[16];        // filter name, NUL padded (e.g. "db4")
+    float threshold;        // denoise threshold; negative for the universal threshold
+    uint32_t output_length; // length of the output path that follows; 0 to stream the result back
+};
+static_assert(sizeof(RequestHeader) == 64, "RequestHeader must have no padding");
+
+struct ResponseHeader {
+    char magic[4];          // "DWTR"
+    uint32_t status;        // 0 on success, 1 on error
+    uint64_t depth, rows, cols;
+    uint64_t payload_bytes; // bytes following the header
+    double seconds;         // time taken by the job, excluding transfers
+};
+static_assert(sizeof(ResponseHeader) == 48, "ResponseHeader must have no padding");
+
+/*
+ * Long-running transform service on a Unix domain socket
+ * The thread pool, workspace, volumes and per-wavelet transform objects are kept
+ * between requests, so a request pays only for its transfer and the transform itself.
+ * Connections are served one at a time; each job runs on the whole pool.
+ */
+class Server {
+public:
+    // Create the socket at the given path (replacing a stale socket, but no other kind of file) and start listening
+    explicit Server(const string& socket_path);
+
+    // Close the socket and remove its file
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Serve connections until SIGINT or SIGTERM
+    void run();
+
+private:
+    // Forward and inverse transforms of one wavelet, created on first use
+    struct Wavelet {
+        DWT dwt;
+        Inverse inverse;
+        Wavelet(const FilterInfo& filter) : dwt(filter.lpf, filter.hpf, filter.size), inverse(filter.Ilpf, filter.Ihpf, filter.size) {}
+    };
+
+    // Serve the requests of one connection until the client closes it
+    void serve_connection(int fd);
+
+    // Run the job of a request; the result is left in 'output'
+    double run_job(const RequestHeader& request);
+
+    // Get the transforms of a wavelet by name
+    Wavelet& wavelet(const string& name);
+
+    string socket_path;
+    int listen_fd = -1;
+    DWTWorkspace workspace;
+    map<string, unique_ptr<Wavelet>> wavelets;
+    Array3D<float> input, output;
+};
+
+#endif // SERVER_H
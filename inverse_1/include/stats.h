@@ -0,0 +1,108 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "utilities/utils.h"
+#include "utilities/parallel.h"
+#include "levels.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Running statistics of the coefficients of one subband
+ * The histogram counts magnitudes in octaves, read straight from the float exponent:
+ * bin 0 holds everything below 2^-24 (including zero), bin k from 1 to 62 holds
+ * [2^(k-25), 2^(k-24)) and the last bin everything from 2^38 up.
+ */
+struct SubbandStats {
+    static const size_t HISTOGRAM_BINS = 64;
+    static const int LOWEST_EXPONENT = -24; // lower edge of bin 1 is 2^LOWEST_EXPONENT
+
+    int level = 0;         // decomposition level (1 = finest)
+    string tag;            // subband name, e.g. "LLH"
+    size_t origin[3] = {}; // depth, row and column of the first coefficient
+    size_t depth = 0, rows = 0, cols = 0;
+
+    uint64_t count = 0;
+    uint64_t zeros = 0;    // coefficients with magnitude at most the zero threshold
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    float min = 0.0f, max = 0.0f;
+    array<uint64_t, HISTOGRAM_BINS> histogram = {};
+
+    // Get the histogram bin of a coefficient
+    static size_t bin(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 - LOWEST_EXPONENT + 1;
+        return static_cast<size_t>(std::min(std::max(exponent, 0), static_cast<int>(HISTOGRAM_BINS) - 1));
+    }
+
+    // Add the statistics of another part of the same subband
+    void merge(const SubbandStats& other) {
+        if (other.count == 0) {
+            return;
+        }
+        min = count == 0 ? other.min : std::min(min, other.min);
+        max = count == 0 ? other.max : std::max(max, other.max);
+        count += other.count;
+        zeros += other.zeros;
+        sum += other.sum;
+        sum_squares += other.sum_squares;
+        for (size_t i = 0; i < HISTOGRAM_BINS; ++i) {
+            histogram[i] += other.histogram[i];
+        }
+    }
+
+    double mean() const { return count ? sum / count : 0.0; }
+    double variance() const { return count ? std::max(0.0, sum_squares / count - mean() * mean()) : 0.0; }
+    double zero_fraction() const { return count ? static_cast<double>(zeros) / count : 0.0; }
+};
+
+/*
+ * Per-subband statistics of a transform, gathered level by level as the transform runs
+ * The detail bands of a level are final once its passes are done, as the deeper levels
+ * only work inside its LLL band, so DWT::dwt_3d hands each level over straight after
+ * its passes, while the bands are still warm in cache, and the file is never read back.
+ * The exception is an odd extent: the bounds of the deeper levels round up and take in
+ * the first high slab, so the bands holding it wait for the last level that reaches it.
+ * Each thread adds into accumulators of its own, merged once at the end.
+ */
+class SubbandStatistics {
+public:
+    /*
+     * Parameters:
+     * - depth, rows, cols: dimensions of the volume
+     * - levels: the levels of the transform (the bands follow IO::export_subbands)
+     * - zero_threshold: magnitude at or below which a coefficient counts as zero
+     * - threads: the number of threads that add into the statistics
+     */
+    SubbandStatistics(size_t depth, size_t rows, size_t cols, const AxisLevels& levels, float zero_threshold, size_t threads);
+
+    // Add the bands that are final once the passes of a level (from 1) are done: the detail bands
+    // of that level and of any shallower one whose first high slab it reached, and at the
+    // deepest level every band left, including the LLL band
+    void add_level(Array3DView<const float> coefficients, int level, ThreadPool& pool);
+
+    // Add every band of a finished transform (for the layouts that do not report level by level)
+    void add_all(Array3DView<const float> coefficients, ThreadPool& pool);
+
+    // Get the statistics of every band, coarsest first, merged over the threads
+    vector<SubbandStats> merged() const;
+
+    // Write the merged statistics as JSON
+    void write_json(const string& filename) const;
+
+private:
+    AxisLevels levels;
+    float zero_threshold;
+    vector<SubbandStats> bands;                  // band layout, in the order of IO::export_subbands
+    vector<int> final_level;                     // level after whose passes each band is final
+    vector<vector<SubbandStats>> thread_stats;   // accumulators of each thread, one per band
+};
+
+#endif // STATS_H
@@ -0,0 +1,33 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "DWT.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Results of one (filter, levels) combination of a sweep
+struct SweepResult {
+    string filter;
+    int levels;
+    double forward_seconds, inverse_seconds;
+    double lll_energy;  // fraction of the coefficient energy in the deepest LLL band (energy compaction)
+    double sparsity;    // fraction of the detail coefficients smaller than the threshold
+    double max_error;   // largest absolute round-trip error
+    double rms_error;   // root mean square round-trip error
+};
+
+/*
+ * Run the forward and inverse transforms for every combination of filter and levels on a
+ * volume read once, several combinations at a time when there is memory for them
+ * Parameters:
+ * - binary_filename, shape_filename: the input volume (or options.dicom_directory)
+ * - filters: names of the filters to try (an alias of one already given is skipped)
+ * - levels: numbers of levels to try
+ * - options: input options, plus the sparsity threshold and the CSV file of the results
+ */
+void perform_sweep(const string& binary_filename, const string& shape_filename, const vector<string>& filters,
+                   const vector<int>& levels, const TransformOptions& options);
+
+#endif // SWEEP_H
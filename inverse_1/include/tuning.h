@@ -0,0 +1,63 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "DWT.h"
+#include <map>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+// Settings of the Convolve/Inverse passes chosen by the autotuner
+struct TuningConfig {
+    string layout;       // linear, compact, tiled or tiled-linear
+    string isa;          // sse2, avx2 or avx512
+    size_t threads = 0;  // worker threads
+    double seconds = 0.0; // forward plus inverse time measured with these settings
+};
+
+// Get the model name of the CPU (from /proc/cpuinfo), or "unknown"
+string cpu_model();
+
+// Get the shape class of a volume: each dimension rounded up to a power of two (e.g. 64x256x256)
+string shape_class(size_t depth, size_t rows, size_t cols);
+
+/*
+ * Tuning database: the fastest settings for each CPU model and shape class
+ * Kept as a small tab separated text file, at DWT_TUNING_DB if it is set and
+ * otherwise at ~/.cache/dwt/tuning.tsv.
+ */
+class TuningDB {
+public:
+    // Load the database (an empty one if the file does not exist yet)
+    explicit TuningDB(const string& path = default_path());
+
+    // Get the default location of the database
+    static string default_path();
+
+    // Look up the settings of a CPU and shape class; returns false if there are none
+    bool lookup(const string& cpu, const string& shape, TuningConfig& config) const;
+
+    // Set the settings of a CPU and shape class, replacing any previous ones
+    void store(const string& cpu, const string& shape, const TuningConfig& config);
+
+    // Write the database back to its file
+    void save() const;
+
+    // Get the location of the database
+    const string& get_path() const { return path; }
+
+private:
+    string path;
+    map<pair<string, string>, TuningConfig> entries;
+};
+
+// Time every candidate combination of layout, instruction set and thread count not fixed by
+// the options on a volume, and return the fastest
+TuningConfig autotune(const Array3D<float>& volume, const FilterInfo& filter, const AxisLevels& levels, const TransformOptions& options);
+
+// Fill in the layout, instruction set and thread count not given in the options from the
+// tuning database (or the defaults: linear layout, best instruction set, all threads)
+void apply_tuning(TransformOptions& options, size_t depth, size_t rows, size_t cols);
+
+#endif // TUNING_H
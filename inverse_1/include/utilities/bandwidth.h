@@ -0,0 +1,51 @@
+#ifndef BANDWIDTH_H
+#define BANDWIDTH_H
+
+#include <vector>
+#include <algorithm>
+#include "parallel.h"
+#include "profiler.h"
+
+using namespace std;
+
+/*
+ * Measure the sustainable memory bandwidth with a STREAM-style triad, a[i] = b[i] + s * c[i]
+ * The arrays are much larger than the last-level cache, and bytes are counted as in STREAM
+ * (three arrays, no write-allocate traffic).
+ * Parameters:
+ * - elements: number of floats in each array
+ * - repetitions: timed runs; the fastest is kept
+ * - nthreads: number of threads to run the triad on
+ * Returns:
+ * - the peak bandwidth in GB/s
+ */
+inline double measure_bandwidth(size_t elements = size_t(1) << 23, int repetitions = 5, size_t nthreads = thread_count()) {
+    vector<float> a(elements, 0.0f), b(elements, 1.0f), c(elements, 2.0f);
+    size_t chunks = max<size_t>(1, nthreads) * 16;
+    size_t chunk = (elements + chunks - 1) / chunks;
+    const float scalar = 3.0f;
+
+    auto triad = [&](size_t k, size_t) {
+        size_t begin = k * chunk, end = min(elements, begin + chunk);
+        float* pa = a.data();
+        const float* pb = b.data();
+        const float* pc = c.data();
+        for (size_t i = begin; i < end; ++i) {
+            pa[i] = pb[i] + scalar * pc[i];
+        }
+    };
+
+    double best = 0.0;
+    for (int run = 0; run <= repetitions; ++run) {
+        double start = monotonic_time();
+        parallel_for(0, chunks, triad, nthreads);
+        double seconds = monotonic_time() - start;
+        // The first run is a warm-up
+        if (run > 0 && seconds > 0.0) {
+            best = max(best, 3.0 * sizeof(float) * elements / seconds * 1e-9);
+        }
+    }
+    return best;
+}
+
+#endif // BANDWIDTH_H
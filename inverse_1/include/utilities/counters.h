@@ -0,0 +1,173 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Most counters that can be read in one group
+constexpr size_t max_counters = 8;
+
+// Counters used when none are named
+constexpr const char* default_counters = "cycles,instructions,L1-dcache-load-misses,LLC-load-misses,dTLB-load-misses";
+
+/*
+ * Group of hardware/software performance counters of the calling thread, read with perf_event_open
+ * Events are given by name (as in perf list: cycles, instructions, cache-misses,
+ * L1-dcache-load-misses, LLC-load-misses, dTLB-load-misses, branch-misses, task-clock,
+ * page-faults, ...) or as raw event codes "rNNNN" (e.g. the vector FP_ARITH events of the CPU).
+ * Events that cannot be opened (unknown names, no PMU in a VM, perf_event_paranoid)
+ * are left out, so reading always succeeds and missing counters read as zero.
+ */
+class CounterGroup {
+public:
+    // Open the named events on the calling thread; with warn set, report the ones that are unavailable
+    CounterGroup(const vector<string>& names, bool warn) : names(names), fds(names.size(), -1) {
+#ifdef __linux__
+        for (size_t i = 0; i < names.size() && i < max_counters; ++i) {
+            perf_event_attr attr;
+            if (!event_attr(names[i], attr)) {
+                if (warn) {
+                    cerr << "Warning: unknown counter " << names[i] << endl;
+                }
+                continue;
+            }
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (warn) {
+                    cerr << "Warning: counter " << names[i] << " is not available (" << strerror(errno) << ")" << endl;
+                }
+                continue;
+            }
+            if (leader < 0) {
+                leader = fd;
+            }
+            fds[i] = fd;
+            order.push_back(i);
+        }
+        if (leader >= 0) {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#else
+        if (warn) {
+            cerr << "Warning: performance counters are only supported on Linux" << endl;
+        }
+#endif
+    }
+
+    ~CounterGroup() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    CounterGroup(const CounterGroup&) = delete;
+    CounterGroup& operator=(const CounterGroup&) = delete;
+
+    // Check whether an event could be opened
+    bool available(size_t i) const { return i < fds.size() && fds[i] >= 0; }
+
+    /*
+     * Read the current counts, scaled up if the group was multiplexed
+     * Parameters:
+     * - values: one count per requested event (zero for events that are not available)
+     */
+    void read(uint64_t* values) const {
+        fill(values, values + names.size(), 0);
+#ifdef __linux__
+        if (leader < 0) {
+            return;
+        }
+        // Layout of PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING
+        uint64_t buffer[3 + max_counters];
+        if (::read(leader, buffer, sizeof(buffer)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+            return;
+        }
+        uint64_t count = buffer[0], enabled = buffer[1], running = buffer[2];
+        double scale = running > 0 && running < enabled ? static_cast<double>(enabled) / running : 1.0;
+        for (size_t k = 0; k < count && k < order.size(); ++k) {
+            values[order[k]] = static_cast<uint64_t>(buffer[3 + k] * scale);
+        }
+#endif
+    }
+
+private:
+#ifdef __linux__
+    // Fill in the perf_event_open attributes of a named event
+    bool event_attr(const string& name, perf_event_attr& attr) const {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.disabled = leader < 0; // the group is enabled through its leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        struct Event {
+            const char* name;
+            uint32_t type;
+            uint64_t config;
+        };
+        static const uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        static const Event events[] = {
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+            {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"L1-dcache-load-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | read_miss},
+            {"LLC-load-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss},
+            {"dTLB-load-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | read_miss},
+            {"iTLB-load-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_ITLB | read_miss},
+            {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+            {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+            {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+            {"cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+        };
+
+        // Raw event codes, e.g. r01c7
+        if (name.size() > 1 && name[0] == 'r') {
+            char* end;
+            uint64_t config = strtoull(name.c_str() + 1, &end, 16);
+            if (*end == '\0') {
+                attr.type = PERF_TYPE_RAW;
+                attr.config = config;
+                return true;
+            }
+        }
+        for (const Event& event : events) {
+            if (name == event.name) {
+                attr.type = event.type;
+                attr.config = event.config;
+                return true;
+            }
+        }
+        return false;
+    }
+#endif
+
+    vector<string> names;
+    vector<int> fds;       // descriptor of each requested event (-1 if not open)
+    vector<size_t> order;  // requested index of each open event, in group order
+    int leader = -1;
+};
+
+#endif // COUNTERS_H
@@ -0,0 +1,146 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+
+/*
+ * Bytes held by the tracked allocators (the storage of Array3D, TiledArray3D and the workspace)
+ * The counts are updated with atomics on every allocation and release, so they
+ * are always on; the peak can be reset to measure the high-water mark of a stage.
+ */
+class MemoryTracker {
+public:
+    // Record an allocation of 'bytes'
+    static void allocated(size_t bytes) {
+        size_t now = current_bytes().fetch_add(bytes, memory_order_relaxed) + bytes;
+        size_t peak = peak_bytes().load(memory_order_relaxed);
+        while (now > peak && !peak_bytes().compare_exchange_weak(peak, now, memory_order_relaxed)) {
+        }
+    }
+
+    // Record the release of an allocation of 'bytes'
+    static void released(size_t bytes) {
+        current_bytes().fetch_sub(bytes, memory_order_relaxed);
+    }
+
+    // Get the bytes currently allocated
+    static size_t current() { return current_bytes().load(memory_order_relaxed); }
+
+    // Get the most bytes allocated at once since the start or the last reset_peak
+    static size_t peak() { return peak_bytes().load(memory_order_relaxed); }
+
+    // Restart the peak from the current allocation
+    static void reset_peak() { peak_bytes().store(current(), memory_order_relaxed); }
+
+private:
+    static atomic<size_t>& current_bytes() {
+        static atomic<size_t> bytes(0);
+        return bytes;
+    }
+
+    static atomic<size_t>& peak_bytes() {
+        static atomic<size_t> bytes(0);
+        return bytes;
+    }
+};
+
+/*
+ * Read a size field (in kB) of a /proc status file
+ * Parameters:
+ * - path: the file, e.g. /proc/self/status or /proc/meminfo
+ * - field: the name of the field, e.g. VmRSS
+ * Returns:
+ * - the size in bytes, or 0 where the file or field is not available
+ */
+inline size_t proc_size_field(const char* path, const char* field) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+    size_t kb = 0, length = strlen(field);
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, field, length) == 0 && line[length] == ':') {
+            kb = strtoull(line + length + 1, nullptr, 10);
+            break;
+        }
+    }
+    fclose(file);
+    return kb * 1024;
+}
+
+// Get a memory size of this process: VmRSS for the current resident set size, VmHWM for its peak (0 if unknown)
+inline size_t process_memory(const char* field) {
+    return proc_size_field("/proc/self/status", field);
+}
+
+// Get the memory that can be allocated without swapping (MemAvailable), or 0 if unknown
+inline size_t available_memory() {
+    return proc_size_field("/proc/meminfo", "MemAvailable");
+}
+
+// Format a byte count in MiB
+inline string format_mib(size_t bytes) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f MiB", bytes / (1024.0 * 1024.0));
+    return text;
+}
+
+/*
+ * Memory used by each stage of a run
+ * mark() closes the current stage: it records the tracked bytes still held and
+ * their peak during the stage, plus the resident set size and its peak so far
+ * (which also include code, stacks and untracked buffers).
+ */
+class MemoryReport {
+public:
+    MemoryReport() { MemoryTracker::reset_peak(); }
+
+    // Close a stage and start the next one
+    void mark(const string& stage) {
+        stages.push_back(Stage{stage, MemoryTracker::current(), MemoryTracker::peak(),
+                               process_memory("VmRSS"), process_memory("VmHWM")});
+        MemoryTracker::reset_peak();
+    }
+
+    // Get the highest tracked peak of any stage
+    size_t peak() const {
+        size_t bytes = 0;
+        for (const Stage& stage : stages) {
+            bytes = max(bytes, stage.peak);
+        }
+        return bytes;
+    }
+
+    // Print one row per stage
+    void print(ostream& out) const {
+        out << left << setw(20) << "Stage" << right << setw(16) << "Held" << setw(16) << "Peak"
+            << setw(16) << "RSS" << setw(16) << "Peak RSS" << "\n";
+        for (const Stage& stage : stages) {
+            out << left << setw(20) << stage.name << right << setw(16) << format_mib(stage.held) << setw(16) << format_mib(stage.peak)
+                << setw(16) << format_mib(stage.rss) << setw(16) << format_mib(stage.peak_rss) << "\n";
+        }
+        out << flush;
+    }
+
+private:
+    struct Stage {
+        string name;
+        size_t held, peak;     // tracked allocations at the end of the stage and at their highest
+        size_t rss, peak_rss;  // resident set size at the end of the stage and its peak so far
+    };
+    vector<Stage> stages;
+};
+
+#endif // MEMORY_H
@@ -0,0 +1,229 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include "profiler.h"
+
+using namespace std;
+
+// Number of worker threads to use (DWT_THREADS overrides the hardware count)
+inline size_t thread_count() {
+    if (const char* env = getenv("DWT_THREADS")) {
+        long n = strtol(env, nullptr, 10);
+        if (n > 0) {
+            return static_cast<size_t>(n);
+        }
+    }
+    size_t n = thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+/*
+ * Split the range [begin, end) into contiguous chunks and run func(i, thread_id)
+ * for every index, one chunk per thread. The first exception thrown by any
+ * thread is rethrown on the calling thread once all threads have finished.
+ * Parameters:
+ * - begin, end: the index range to process
+ * - func: callable taking the index and the id of the thread running it
+ * - nthreads: maximum number of threads to use
+ */
+template <class Func>
+void parallel_for(size_t begin, size_t end, Func func, size_t nthreads = thread_count()) {
+    if (end <= begin) {
+        return;
+    }
+    size_t count = end - begin;
+    nthreads = min(nthreads, count);
+
+    // Run small ranges on the calling thread
+    if (nthreads <= 1) {
+        for (size_t i = begin; i < end; ++i) {
+            func(i, size_t(0));
+        }
+        return;
+    }
+
+    vector<thread> threads;
+    threads.reserve(nthreads - 1);
+    size_t chunk = (count + nthreads - 1) / nthreads;
+
+    exception_ptr error;
+    mutex error_mutex;
+    SpanRef parent = Profiler::current();
+
+    auto run_chunk = [&](size_t t) {
+        PROFILE_SCOPE("chunk", -1, -1, parent);
+        size_t first = begin + t * chunk;
+        size_t last = min(end, first + chunk);
+        try {
+            for (size_t i = first; i < last; ++i) {
+                func(i, t);
+            }
+        } catch (...) {
+            lock_guard<mutex> lock(error_mutex);
+            if (!error) {
+                error = current_exception();
+            }
+        }
+    };
+
+    for (size_t t = 1; t < nthreads; ++t) {
+        threads.emplace_back(run_chunk, t);
+    }
+    run_chunk(0);
+
+    // Wait for all threads to complete
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+/*
+ * Fixed set of worker threads that are started once and reused for every
+ * parallel_for call, so repeated passes pay no thread start-up or allocation cost.
+ * The calling thread takes part in the work as thread 0.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t nthreads = thread_count()) : nthreads(max<size_t>(1, nthreads)) {
+        for (size_t t = 1; t < this->nthreads; ++t) {
+            workers.emplace_back(&ThreadPool::worker, this, t);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+            ++generation;
+        }
+        start.notify_all();
+        for (auto& th : workers) {
+            th.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Get the number of threads (including the calling thread)
+    size_t size() const { return nthreads; }
+
+    // Run func(i, thread_id) for every index in [begin, end), one contiguous chunk per thread
+    template <class Func>
+    void parallel_for(size_t begin, size_t end, Func func) {
+        if (end <= begin) {
+            return;
+        }
+        Range<Func> range{&func, begin, end, (end - begin + nthreads - 1) / nthreads, Profiler::current()};
+
+        // Run on the calling thread only when there is nothing to share
+        if (nthreads == 1 || end - begin == 1) {
+            run_chunk<Func>(&range, 0);
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(m);
+            task = &run_chunk<Func>;
+            context = &range;
+            pending = nthreads - 1;
+            error = nullptr;
+            ++generation;
+        }
+        start.notify_all();
+
+        // Do the first chunk here, then wait for the workers
+        exception_ptr local_error;
+        try {
+            run_chunk<Func>(&range, 0);
+        } catch (...) {
+            local_error = current_exception();
+        }
+
+        unique_lock<mutex> lock(m);
+        finished.wait(lock, [this] { return pending == 0; });
+        if (local_error) {
+            rethrow_exception(local_error);
+        }
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+private:
+    template <class Func>
+    struct Range {
+        Func* func;
+        size_t begin, end, chunk;
+        SpanRef parent; // span of the caller, for profiling
+    };
+
+    // Run the chunk of a range that belongs to thread t
+    template <class Func>
+    static void run_chunk(void* context, size_t t) {
+        Range<Func>* range = static_cast<Range<Func>*>(context);
+        PROFILE_SCOPE("chunk", -1, -1, range->parent);
+        size_t first = range->begin + t * range->chunk;
+        size_t last = min(range->end, first + range->chunk);
+        for (size_t i = first; i < last; ++i) {
+            (*range->func)(i, t);
+        }
+    }
+
+    void worker(size_t t) {
+        size_t seen = 0;
+        while (true) {
+            void (*current_task)(void*, size_t);
+            void* current_context;
+            {
+                unique_lock<mutex> lock(m);
+                start.wait(lock, [&] { return generation != seen; });
+                seen = generation;
+                if (stopping) {
+                    return;
+                }
+                current_task = task;
+                current_context = context;
+            }
+
+            try {
+                current_task(current_context, t);
+            } catch (...) {
+                lock_guard<mutex> lock(m);
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+
+            {
+                lock_guard<mutex> lock(m);
+                --pending;
+            }
+            finished.notify_one();
+        }
+    }
+
+    size_t nthreads;
+    vector<thread> workers;
+    mutex m;
+    condition_variable start, finished;
+    size_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+    void (*task)(void*, size_t) = nullptr;
+    void* context = nullptr;
+    exception_ptr error;
+};
+
+#endif // PARALLEL_H
@@ -0,0 +1,404 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <time.h>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <sstream>
+#include "counters.h"
+
+using namespace std;
+
+// Current time in seconds on a monotonic clock (as jbutil::gettime, but never jumps with the wall clock)
+inline double monotonic_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1E-9;
+}
+
+// Reference to a span recorded by the Profiler (thread buffer and position in it)
+struct SpanRef {
+    uint32_t thread = UINT32_MAX;
+    uint32_t index = UINT32_MAX;
+};
+
+/*
+ * Hierarchical timing of the transform stages
+ * Spans are recorded by ScopedTimer objects into per-thread buffers (no locking
+ * after a thread's first span). Each span remembers its parent, which may be on
+ * another thread (the span that started a parallel_for), so the summary can
+ * attribute worker time to the stage, level and axis it belongs to.
+ * Profiling is enabled by DWT_TRACE=<trace file> or Profiler::enable(); when it is
+ * disabled a ScopedTimer costs one test of a flag, and defining DWT_NO_PROFILE
+ * removes the timers entirely. With DWT_COUNTERS=<event list> or enable_counters(),
+ * each span also records the change in a group of performance counters. Kernels
+ * can attach the bytes they move and the flops they do to their span (add_work),
+ * which the summary turns into GB/s, GFLOP/s and a fraction of the peak bandwidth.
+ */
+class Profiler {
+public:
+    // Check whether spans are being recorded
+    static bool enabled() { return state().active; }
+
+    // Start recording spans; the trace is written to trace_file by finish() (if not empty)
+    static void enable(const string& trace_file) {
+        State& s = state();
+        s.trace_file = trace_file;
+        s.origin = monotonic_time();
+        s.active = true;
+    }
+
+    // Also record performance counters in every span (a comma separated list, empty for the defaults)
+    static void enable_counters(const string& list) {
+        state().counters = parse_counters(list);
+    }
+
+    /*
+     * Open a span on the calling thread
+     * Parameters:
+     * - name: name of the stage (must be a string literal or otherwise outlive the profiler)
+     * - level, axis: decomposition level and axis of the span, or -1
+     * - parent: parent span on another thread; by default the innermost open span of this thread
+     * Returns:
+     * - the reference to pass to end()
+     */
+    static SpanRef begin(const char* name, int level, int axis, SpanRef parent = SpanRef()) {
+        ThreadTrace& trace = local();
+        if (parent.thread == UINT32_MAX && !trace.open.empty()) {
+            parent = SpanRef{trace.id, trace.open.back()};
+        }
+        trace.spans.push_back(Span{name, level, axis, parent, 0.0, 0.0, {}, 0.0, 0.0});
+        trace.open.push_back(static_cast<uint32_t>(trace.spans.size() - 1));
+
+        // Read the counters (start values, replaced by the change in end()) last, so they cover little of the profiler
+        Span& span = trace.spans.back();
+        if (trace.group) {
+            trace.group->read(span.counters);
+        }
+        span.start = monotonic_time();
+        return SpanRef{trace.id, trace.open.back()};
+    }
+
+    // Close a span opened by begin()
+    static void end(SpanRef ref) {
+        ThreadTrace& trace = local();
+        Span& span = trace.spans[ref.index];
+        span.end = monotonic_time();
+        if (trace.group) {
+            uint64_t now[max_counters];
+            trace.group->read(now);
+            for (size_t i = 0; i < state().counters.size(); ++i) {
+                span.counters[i] = now[i] - span.counters[i];
+            }
+        }
+        trace.open.pop_back();
+    }
+
+    // Add the memory traffic and arithmetic of a kernel to the innermost open span of the calling thread
+    static void add_work(double bytes, double flops) {
+        if (!enabled()) {
+            return;
+        }
+        ThreadTrace& trace = local();
+        if (!trace.open.empty()) {
+            Span& span = trace.spans[trace.open.back()];
+            span.bytes += bytes;
+            span.flops += flops;
+        }
+    }
+
+    // Set the measured peak memory bandwidth (GB/s), against which the summary rates the kernels
+    static void set_peak_bandwidth(double gbs) {
+        state().peak_bandwidth = gbs;
+    }
+
+    // Get the innermost open span of the calling thread (to pass as parent to other threads)
+    static SpanRef current() {
+        if (!enabled()) {
+            return SpanRef();
+        }
+        ThreadTrace& trace = local();
+        return trace.open.empty() ? SpanRef() : SpanRef{trace.id, trace.open.back()};
+    }
+
+    // Write all the spans as Chrome trace-event JSON (viewable in chrome://tracing or Perfetto)
+    static void write_trace(const string& filename) {
+        ofstream file(filename);
+        if (!file) {
+            throw runtime_error("Error opening file for writing: " + filename);
+        }
+        State& s = state();
+        lock_guard<mutex> lock(s.m);
+
+        vector<size_t> columns = available_counters();
+        file << "{\"traceEvents\": [\n" << fixed << setprecision(3);
+        bool first = true;
+        for (const auto& trace : s.threads) {
+            for (const Span& span : trace->spans) {
+                file << (first ? "" : ",\n") << "  {\"name\": \"" << span.name << "\", \"cat\": \"dwt\", \"ph\": \"X\", \"pid\": 1"
+                     << ", \"tid\": " << trace->id << ", \"ts\": " << (span.start - s.origin) * 1e6
+                     << ", \"dur\": " << (span.end - span.start) * 1e6 << ", \"args\": {";
+                if (span.level >= 0) {
+                    file << "\"level\": " << span.level << (span.axis >= 0 ? ", " : "");
+                }
+                if (span.axis >= 0) {
+                    file << "\"axis\": " << span.axis;
+                }
+                for (size_t i : columns) {
+                    file << (span.level >= 0 || span.axis >= 0 || i != columns.front() ? ", " : "")
+                         << "\"" << s.counters[i] << "\": " << span.counters[i];
+                }
+                file << "}}";
+                first = false;
+            }
+        }
+        file << "\n], \"displayTimeUnit\": \"ms\"}" << endl;
+    }
+
+    // Print the total, count and mean time of every stage path (e.g. "forward/level 1/dim0/chunk")
+    static void print_summary(ostream& out) {
+        State& s = state();
+        lock_guard<mutex> lock(s.m);
+
+        struct Total {
+            double seconds = 0.0;
+            size_t count = 0;
+            uint64_t counters[max_counters] = {};
+            double bytes = 0.0, flops = 0.0;
+        };
+        map<string, Total> totals;
+        for (const auto& trace : s.threads) {
+            for (const Span& span : trace->spans) {
+                Total& total = totals[path(span)];
+                total.seconds += span.end - span.start;
+                ++total.count;
+                for (size_t i = 0; i < s.counters.size(); ++i) {
+                    total.counters[i] += span.counters[i];
+                }
+                total.bytes += span.bytes;
+                total.flops += span.flops;
+            }
+        }
+
+        // Rate columns, if any kernel reported its work
+        bool rates = false;
+        for (const auto& entry : totals) {
+            rates = rates || entry.second.bytes > 0.0;
+        }
+        bool peak = rates && s.peak_bandwidth > 0.0;
+
+        // Counter columns (totals over the spans), plus instructions per cycle when both are counted
+        vector<size_t> columns = available_counters();
+        int cycles = -1, instructions = -1;
+        for (size_t i : columns) {
+            cycles = s.counters[i] == "cycles" ? static_cast<int>(i) : cycles;
+            instructions = s.counters[i] == "instructions" ? static_cast<int>(i) : instructions;
+        }
+
+        out << "\n" << left << setw(48) << "Stage" << right << setw(10) << "Count" << setw(14) << "Total (ms)" << setw(14) << "Mean (ms)";
+        for (size_t i : columns) {
+            out << setw(max<int>(14, s.counters[i].size() + 2)) << s.counters[i];
+        }
+        if (cycles >= 0 && instructions >= 0) {
+            out << setw(8) << "IPC";
+        }
+        if (rates) {
+            out << setw(10) << "GB/s" << setw(10) << "GFLOP/s" << setw(12) << "Flop/byte";
+        }
+        if (peak) {
+            out << setw(12) << "% peak BW";
+        }
+        out << "\n" << fixed << setprecision(3);
+        for (const auto& entry : totals) {
+            const Total& total = entry.second;
+            out << left << setw(48) << entry.first << right << setw(10) << total.count
+                << setw(14) << total.seconds * 1e3 << setw(14) << total.seconds * 1e3 / total.count;
+            for (size_t i : columns) {
+                out << setw(max<int>(14, s.counters[i].size() + 2)) << total.counters[i];
+            }
+            if (cycles >= 0 && instructions >= 0) {
+                out << setw(8) << setprecision(2) << (total.counters[cycles] ? double(total.counters[instructions]) / total.counters[cycles] : 0.0) << setprecision(3);
+            }
+            if (total.bytes > 0.0 && total.seconds > 0.0) {
+                double gbs = total.bytes / total.seconds * 1e-9;
+                out << setprecision(2) << setw(10) << gbs << setw(10) << total.flops / total.seconds * 1e-9
+                    << setw(12) << total.flops / total.bytes;
+                if (peak) {
+                    out << setw(11) << 100.0 * gbs / s.peak_bandwidth << "%";
+                }
+                out << setprecision(3);
+            }
+            out << "\n";
+        }
+        if (peak) {
+            out << "Peak memory bandwidth (triad): " << setprecision(2) << s.peak_bandwidth << " GB/s\n";
+        }
+        out << defaultfloat << endl;
+    }
+
+    // Print the summary and write the trace file, if profiling is enabled
+    static void finish() {
+        if (!enabled()) {
+            return;
+        }
+        print_summary(cout);
+        const string& trace_file = state().trace_file;
+        if (!trace_file.empty()) {
+            write_trace(trace_file);
+            cout << "Trace written to " << trace_file << endl;
+        }
+    }
+
+private:
+    struct Span {
+        const char* name;
+        int level, axis;
+        SpanRef parent;
+        double start, end;
+        uint64_t counters[max_counters]; // change in each performance counter
+        double bytes, flops;             // work reported by the kernels (add_work)
+    };
+
+    // Spans recorded by one thread
+    struct ThreadTrace {
+        uint32_t id;
+        vector<Span> spans;
+        vector<uint32_t> open; // indices of the spans that are still open, innermost last
+        unique_ptr<CounterGroup> group; // performance counters of the thread, if enabled
+    };
+
+    struct State {
+        bool active = false;
+        string trace_file;
+        double origin = 0.0;
+        mutex m;
+        vector<unique_ptr<ThreadTrace>> threads; // buffers are kept after their thread exits
+        vector<string> counters; // names of the performance counters to record (empty for none)
+        double peak_bandwidth = 0.0; // measured peak memory bandwidth in GB/s (0 if not measured)
+
+        State() {
+            if (const char* env = getenv("DWT_TRACE")) {
+                trace_file = env;
+                origin = monotonic_time();
+                active = true;
+            }
+            if (const char* env = getenv("DWT_COUNTERS")) {
+                active = true;
+                counters = parse_counters(env);
+            }
+        }
+    };
+
+    static State& state() {
+        static State s;
+        return s;
+    }
+
+    // Get the buffer of the calling thread, registering it on first use
+    static ThreadTrace& local() {
+        thread_local ThreadTrace* trace = nullptr;
+        if (!trace) {
+            State& s = state();
+            lock_guard<mutex> lock(s.m);
+            s.threads.push_back(unique_ptr<ThreadTrace>(new ThreadTrace{static_cast<uint32_t>(s.threads.size()), {}, {}, nullptr}));
+            trace = s.threads.back().get();
+            if (!s.counters.empty()) {
+                // Only the first thread reports counters that cannot be opened
+                trace->group.reset(new CounterGroup(s.counters, trace->id == 0));
+            }
+        }
+        return *trace;
+    }
+
+    // Split a comma separated list of counter names (empty for the defaults)
+    static vector<string> parse_counters(const string& list) {
+        vector<string> names;
+        stringstream ss(list.empty() ? string(default_counters) : list);
+        string name;
+        while (getline(ss, name, ',') && names.size() < max_counters) {
+            if (!name.empty()) {
+                names.push_back(name);
+            }
+        }
+        return names;
+    }
+
+    // Indices of the counters that could be opened (on the first thread; the caller holds the state lock)
+    static vector<size_t> available_counters() {
+        State& s = state();
+        vector<size_t> columns;
+        if (!s.threads.empty() && s.threads[0]->group) {
+            for (size_t i = 0; i < s.counters.size(); ++i) {
+                if (s.threads[0]->group->available(i)) {
+                    columns.push_back(i);
+                }
+            }
+        }
+        return columns;
+    }
+
+    // Label of a span in the summary
+    static string label(const Span& span) {
+        string text = span.name;
+        if (span.level >= 0) {
+            text += " " + to_string(span.level);
+        }
+        return text;
+    }
+
+    // Path of a span from its outermost ancestor (the caller holds the state lock)
+    static string path(const Span& span) {
+        string text = label(span);
+        SpanRef parent = span.parent;
+        while (parent.thread != UINT32_MAX) {
+            const Span& p = state().threads[parent.thread]->spans[parent.index];
+            text = label(p) + "/" + text;
+            parent = p.parent;
+        }
+        return text;
+    }
+};
+
+// Records a span from construction to the end of the scope, if profiling is enabled
+class ScopedTimer {
+public:
+    ScopedTimer(const char* name, int level = -1, int axis = -1, SpanRef parent = SpanRef()) {
+        if (Profiler::enabled()) {
+            ref = Profiler::begin(name, level, axis, parent);
+            recording = true;
+        }
+    }
+
+    ~ScopedTimer() {
+        if (recording) {
+            Profiler::end(ref);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    SpanRef ref;
+    bool recording = false;
+};
+
+// Time the rest of the enclosing scope: PROFILE_SCOPE("name"[, level[, axis[, parent]]])
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#ifdef DWT_NO_PROFILE
+#define PROFILE_SCOPE(...)
+#else
+#define PROFILE_SCOPE(...) ScopedTimer PROFILE_CONCAT(profile_scope_, __LINE__)(__VA_ARGS__)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,166 @@
+#ifndef TILED_H
+#define TILED_H
+
+#include "utils.h"
+#include <cstdint>
+#include <numeric>
+
+using namespace std;
+
+// Order in which the tiles of a TiledArray3D are stored
+enum class TileOrder {
+    Linear, // tile-major, row-major over the tile grid
+    Morton  // Z-order over the tile grid
+};
+
+/*
+ * 3D array stored as small cubic tiles of Tile x Tile x Tile elements, so that
+ * lines along any of the three axes touch a similar number of cache lines and
+ * pages. The dimensions are padded up to whole tiles. Lines are accessed with
+ * load_line/store_line, which gather/scatter one line into a contiguous buffer.
+ */
+template <class T, size_t Tile = 8>
+class TiledArray3D {
+private:
+    static constexpr size_t tile_elements = Tile * Tile * Tile;
+
+    vector<T, uninitialised_allocator<T, 64>> data;
+    size_t depth, rows, cols;
+    size_t tiles_depth, tiles_rows, tiles_cols;
+    vector<uint32_t> tile_offset; // position of each tile (indexed row-major over the grid)
+
+    // Interleave the bits of the tile coordinates to get the Z-order key
+    static uint64_t morton_key(uint64_t d, uint64_t r, uint64_t c) {
+        uint64_t key = 0;
+        for (unsigned bit = 0; bit < 21; ++bit) {
+            key |= ((c >> bit) & 1) << (3 * bit);
+            key |= ((r >> bit) & 1) << (3 * bit + 1);
+            key |= ((d >> bit) & 1) << (3 * bit + 2);
+        }
+        return key;
+    }
+
+    // Distance in elements between consecutive elements of a tile along an axis
+    static constexpr size_t axis_stride(int axis) {
+        return axis == 0 ? Tile : (axis == 1 ? 1 : Tile * Tile);
+    }
+
+    // Index of the element (d, r, c) in the storage
+    size_t index(size_t d, size_t r, size_t c) const {
+        size_t tile = (d / Tile * tiles_rows + r / Tile) * tiles_cols + c / Tile;
+        return tile_offset[tile] * tile_elements + ((d % Tile) * Tile + (r % Tile)) * Tile + (c % Tile);
+    }
+
+public:
+    // Constructor to initialize the tiled array with given dimensions and tile order
+    TiledArray3D(size_t d, size_t r, size_t c, TileOrder order = TileOrder::Morton)
+        : depth(d), rows(r), cols(c),
+          tiles_depth((d + Tile - 1) / Tile), tiles_rows((r + Tile - 1) / Tile), tiles_cols((c + Tile - 1) / Tile) {
+        size_t tiles = tiles_depth * tiles_rows * tiles_cols;
+        data.resize(tiles * tile_elements);
+
+        // Rank the tiles by their position in the chosen order
+        tile_offset.resize(tiles);
+        iota(tile_offset.begin(), tile_offset.end(), 0);
+        if (order == TileOrder::Morton) {
+            vector<uint32_t> ranked(tiles);
+            iota(ranked.begin(), ranked.end(), 0);
+            vector<uint64_t> keys(tiles);
+            for (size_t i = 0; i < tiles; ++i) {
+                keys[i] = morton_key(i / (tiles_rows * tiles_cols), (i / tiles_cols) % tiles_rows, i % tiles_cols);
+            }
+            sort(ranked.begin(), ranked.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+            for (size_t i = 0; i < tiles; ++i) {
+                tile_offset[ranked[i]] = static_cast<uint32_t>(i);
+            }
+        }
+    }
+
+    // Get the number of elements an array of the given dimensions allocates (whole tiles)
+    static size_t storage_size(size_t d, size_t r, size_t c) {
+        return ((d + Tile - 1) / Tile) * ((r + Tile - 1) / Tile) * ((c + Tile - 1) / Tile) * tile_elements;
+    }
+
+    // Element access operators
+    T& operator()(size_t d, size_t r, size_t c) {
+        assert(d < depth && r < rows && c < cols);
+        return data[index(d, r, c)];
+    }
+
+    const T& operator()(size_t d, size_t r, size_t c) const {
+        assert(d < depth && r < rows && c < cols);
+        return data[index(d, r, c)];
+    }
+
+    /*
+     * Copy n elements of a line along an axis into a contiguous buffer
+     * Parameters:
+     * - axis: 0 = rows, 1 = columns, 2 = depth (as in Convolve::dim0/1/2)
+     * - d, r, c: coordinates of the first element of the line
+     * - n: number of elements to copy
+     * - out: destination buffer
+     */
+    void load_line(int axis, size_t d, size_t r, size_t c, size_t n, T* out) const {
+        size_t pos = axis == 0 ? r : (axis == 1 ? c : d);
+        size_t stride = axis_stride(axis);
+        for (size_t i = 0; i < n;) {
+            // Copy the part of the line inside the current tile
+            size_t p = pos + i;
+            size_t count = min(n - i, Tile - p % Tile);
+            const T* src = &data[index(axis == 2 ? p : d, axis == 0 ? p : r, axis == 1 ? p : c)];
+            for (size_t k = 0; k < count; ++k) {
+                out[i + k] = src[k * stride];
+            }
+            i += count;
+        }
+    }
+
+    // Copy n elements from a contiguous buffer into a line along an axis
+    void store_line(int axis, size_t d, size_t r, size_t c, size_t n, const T* in) {
+        size_t pos = axis == 0 ? r : (axis == 1 ? c : d);
+        size_t stride = axis_stride(axis);
+        for (size_t i = 0; i < n;) {
+            size_t p = pos + i;
+            size_t count = min(n - i, Tile - p % Tile);
+            T* dst = &data[index(axis == 2 ? p : d, axis == 0 ? p : r, axis == 1 ? p : c)];
+            for (size_t k = 0; k < count; ++k) {
+                dst[k * stride] = in[i + k];
+            }
+            i += count;
+        }
+    }
+
+    // Copy the contents of a linear array (with contiguous rows) into the tiled array
+    void assign(Array3DView<const T> src) {
+        assert(src.get_depth() == depth && src.get_rows() == rows && src.get_cols() == cols && src.get_col_stride() == 1);
+        for (size_t d = 0; d < depth; ++d) {
+            for (size_t r = 0; r < rows; ++r) {
+                if (cols > 0) {
+                    store_line(1, d, r, 0, cols, &src(d, r, 0));
+                }
+            }
+        }
+    }
+
+    // Copy the contents of the tiled array into a linear array (with contiguous rows)
+    void extract(Array3DView<T> dst) const {
+        assert(dst.get_depth() == depth && dst.get_rows() == rows && dst.get_cols() == cols && dst.get_col_stride() == 1);
+        for (size_t d = 0; d < depth; ++d) {
+            for (size_t r = 0; r < rows; ++r) {
+                if (cols > 0) {
+                    load_line(1, d, r, 0, cols, &dst(d, r, 0));
+                }
+            }
+        }
+    }
+
+    // Get the dimensions of the tiled array
+    size_t get_depth() const { return depth; }
+    size_t get_rows() const { return rows; }
+    size_t get_cols() const { return cols; }
+
+    // Get the total number of elements in the tiled array
+    size_t size() const { return depth * rows * cols; }
+};
+
+#endif // TILED_H
@@ -2,31 +2,219 @@
 #define UTILS_H
 
 #include <vector>
+#include <algorithm>
 #include <cassert>
+#include <new>
+#include <utility>
+#include <memory>
+#include <cstdlib>
+#include <cstddef>
+#include <type_traits>
+#include "memory.h"
 
 using namespace std;
 
-// Template class for a custom 3D array
+// Aligned allocator (as jbutil::aligned_allocator) that leaves elements default-initialised
+// (i.e. uninitialised for plain types) when constructed without a value, avoiding a
+// wasted zeroing pass. Allocations are counted by the MemoryTracker.
+template <class T, size_t alignment>
+class uninitialised_allocator : public std::allocator<T> {
+public:
+    template <class U>
+    struct rebind {
+        typedef uninitialised_allocator<U, alignment> other;
+    };
+
+    uninitialised_allocator() = default;
+
+    template <class U>
+    uninitialised_allocator(const uninitialised_allocator<U, alignment>&) {}
+
+    T* allocate(size_t n) {
+        void* p;
+        if (posix_memalign(&p, alignment, n * sizeof(T)) == 0) {
+            MemoryTracker::allocated(n * sizeof(T));
+            return static_cast<T*>(p);
+        }
+        throw std::bad_alloc();
+    }
+
+    void deallocate(T* p, size_t n) {
+        MemoryTracker::released(n * sizeof(T));
+        free(p);
+    }
+
+    // Default-initialise instead of value-initialise
+    template <class U>
+    void construct(U* p) {
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+// Storage policy: packed std::vector, row pitch equal to the number of columns
+struct PackedStorage {
+    template <class T>
+    using allocator = std::allocator<T>;
+
+    static size_t pitch(size_t count, size_t) { return count; }
+};
+
+// Storage policy: aligned allocation with row and slice pitch padded to a whole
+// number of alignment units, plus one extra unit when the pitch would be a
+// multiple of the aliasing stride (so power-of-two widths such as 512 do not map
+// successive rows or slices onto the same cache sets)
+template <size_t alignment = 64, bool padded = true, size_t aliasing_stride = 1024>
+struct AlignedStorage {
+    template <class T>
+    using allocator = uninitialised_allocator<T, alignment>;
+
+    static size_t pitch(size_t count, size_t element_size) {
+        if (!padded) {
+            return count;
+        }
+        size_t unit = alignment / element_size;
+        size_t p = (count + unit - 1) / unit * unit;
+        if ((p * element_size) % aliasing_stride == 0) {
+            p += unit;
+        }
+        return p;
+    }
+};
+
+// Tag to request an array whose contents will be overwritten before being read
+struct uninitialised_t {};
+constexpr uninitialised_t uninitialised{};
+
+// Non-owning view of a strided 3D sub-volume (e.g. a subband, slab or ROI of an Array3D)
 template <class T>
+class Array3DView {
+private:
+    T* base;
+    size_t depth, rows, cols;
+    ptrdiff_t slice_stride, row_stride, col_stride; // distance in elements along each axis
+
+public:
+    // Default constructor (empty view)
+    Array3DView() : base(nullptr), depth(0), rows(0), cols(0), slice_stride(0), row_stride(0), col_stride(1) {}
+
+    // Constructor from a pointer to the first element, the dimensions and the strides
+    Array3DView(T* base, size_t d, size_t r, size_t c, ptrdiff_t slice_stride, ptrdiff_t row_stride, ptrdiff_t col_stride = 1)
+        : base(base), depth(d), rows(r), cols(c), slice_stride(slice_stride), row_stride(row_stride), col_stride(col_stride) {}
+
+    // View of a whole array (also allows passing an Array3D where a view is expected)
+    template <class A, class = decltype(declval<A&>().get_slice_pitch())>
+    Array3DView(A& array)
+        : Array3DView(array.get_data(), array.get_depth(), array.get_rows(), array.get_cols(), array.get_slice_pitch(), array.get_row_pitch()) {}
+
+    // Conversion from a mutable view to a read-only view
+    template <class U, class = typename enable_if<is_same<const U, T>::value && !is_same<U, T>::value>::type>
+    Array3DView(const Array3DView<U>& other)
+        : Array3DView(other.get_data(), other.get_depth(), other.get_rows(), other.get_cols(),
+                      other.get_slice_stride(), other.get_row_stride(), other.get_col_stride()) {}
+
+    // Element access operator
+    T& operator()(size_t d, size_t r, size_t c) const {
+        assert(d < depth && r < rows && c < cols);
+        return base[d * slice_stride + r * row_stride + c * col_stride];
+    }
+
+    // Address of the element (d, r, c), without a bounds check (e.g. the start of a line
+    // that may be empty)
+    T* address(size_t d, size_t r, size_t c) const {
+        return base + static_cast<ptrdiff_t>(d) * slice_stride + static_cast<ptrdiff_t>(r) * row_stride + static_cast<ptrdiff_t>(c) * col_stride;
+    }
+
+    // View of a box inside this view, starting at (d0, r0, c0)
+    Array3DView subview(size_t d0, size_t r0, size_t c0, size_t d, size_t r, size_t c) const {
+        assert(d0 + d <= depth && r0 + r <= rows && c0 + c <= cols);
+        return Array3DView(base + d0 * slice_stride + r0 * row_stride + c0 * col_stride, d, r, c, slice_stride, row_stride, col_stride);
+    }
+
+    // Get the dimensions of the view
+    size_t get_depth() const { return depth; }
+    size_t get_rows() const { return rows; }
+    size_t get_cols() const { return cols; }
+
+    // Get the strides of the view
+    ptrdiff_t get_slice_stride() const { return slice_stride; }
+    ptrdiff_t get_row_stride() const { return row_stride; }
+    ptrdiff_t get_col_stride() const { return col_stride; }
+
+    // Get the total number of elements in the view
+    size_t size() const { return depth * rows * cols; }
+
+    // Get a pointer to the first element
+    T* get_data() const { return base; }
+};
+
+// Copy the elements of one view into another of the same dimensions
+template <class S, class T>
+void copy_view(const Array3DView<S>& src, const Array3DView<T>& dst) {
+    assert(src.get_depth() == dst.get_depth() && src.get_rows() == dst.get_rows() && src.get_cols() == dst.get_cols());
+    for (size_t d = 0; d < src.get_depth(); ++d) {
+        for (size_t r = 0; r < src.get_rows(); ++r) {
+            if (src.get_col_stride() == 1 && dst.get_col_stride() == 1 && src.get_cols() > 0) {
+                // Copy contiguous rows in one go
+                copy_n(&src(d, r, 0), src.get_cols(), &dst(d, r, 0));
+                continue;
+            }
+            for (size_t c = 0; c < src.get_cols(); ++c) {
+                dst(d, r, c) = src(d, r, c);
+            }
+        }
+    }
+}
+
+// Check whether two views cover the same elements in the same order
+template <class S, class T>
+bool same_layout(const Array3DView<S>& a, const Array3DView<T>& b) {
+    return static_cast<const void*>(a.get_data()) == static_cast<const void*>(b.get_data()) &&
+           a.get_depth() == b.get_depth() && a.get_rows() == b.get_rows() && a.get_cols() == b.get_cols() &&
+           a.get_slice_stride() == b.get_slice_stride() && a.get_row_stride() == b.get_row_stride() && a.get_col_stride() == b.get_col_stride();
+}
+
+// Template class for a custom 3D array
+template <class T, class Storage = AlignedStorage<>>
 class Array3D {
 private:
-    vector<T> data; 
-    size_t depth, rows, cols; 
+    vector<T, typename Storage::template allocator<T>> data;
+    size_t depth, rows, cols;
+    size_t row_pitch, slice_pitch; // distance in elements between rows and between slices
+
+    // Calculate the padded pitches for the current dimensions
+    void set_pitches() {
+        row_pitch = Storage::pitch(cols, sizeof(T));
+        slice_pitch = Storage::pitch(rows * row_pitch, sizeof(T));
+    }
 
 public:
     // Default constructor
-    Array3D() : depth(0), rows(0), cols(0) {}
+    Array3D() : depth(0), rows(0), cols(0), row_pitch(0), slice_pitch(0) {}
+
+    // Constructor to initialize the 3D array with given dimensions (elements set to zero)
+    Array3D(size_t d, size_t r, size_t c) : depth(d), rows(r), cols(c) {
+        set_pitches();
+        data.assign(d * slice_pitch, T());
+    }
 
-    // Constructor to initialize the 3D array with given dimensions
-    Array3D(size_t d, size_t r, size_t c) : data(d * r * c), depth(d), rows(r), cols(c) {}
+    // Constructor that leaves the elements uninitialised, for arrays that are fully overwritten
+    Array3D(size_t d, size_t r, size_t c, uninitialised_t) : depth(d), rows(r), cols(c) {
+        set_pitches();
+        data.resize(d * slice_pitch);
+    }
 
-        // Access the underlying data as a 1D array
+    // Access the underlying storage as a 1D array (includes any row/slice padding)
     T& operator[](size_t index) {
         assert(index < data.size());
         return data[index];
     }
 
-    // Const access to the underlying data as a 1D array
+    // Const access to the underlying storage as a 1D array
     const T& operator[](size_t index) const {
         assert(index < data.size());
         return data[index];
@@ -34,14 +222,14 @@ public:
 
     // Non-const element access operator
     T& operator()(size_t d, size_t r, size_t c) {
-        assert(d < depth && r < rows && c < cols); 
-        return data[d * rows * cols + r * cols + c]; // Calculate the 1D index and return the element
+        assert(d < depth && r < rows && c < cols);
+        return data[d * slice_pitch + r * row_pitch + c]; // Calculate the 1D index and return the element
     }
 
     // Const element access operator
     const T& operator()(size_t d, size_t r, size_t c) const {
-        assert(d < depth && r < rows && c < cols); 
-        return data[d * rows * cols + r * cols + c]; // Calculate the 1D index and return the element
+        assert(d < depth && r < rows && c < cols);
+        return data[d * slice_pitch + r * row_pitch + c]; // Calculate the 1D index and return the element
     }
 
     // Get the depth of the 3D array
@@ -53,9 +241,52 @@ public:
     // Get the number of columns in the 3D array
     size_t get_cols() const { return cols; }
 
+    // Get the distance in elements between consecutive rows
+    size_t get_row_pitch() const { return row_pitch; }
+
+    // Get the distance in elements between consecutive slices
+    size_t get_slice_pitch() const { return slice_pitch; }
+
     // Get the total number of elements in the 3D array
-    size_t size() const { return data.size(); }
+    size_t size() const { return depth * rows * cols; }
+
+    // Get the number of elements allocated, including padding
+    size_t storage_size() const { return data.size(); }
+
+    // Get the number of elements an array of the given dimensions allocates, including padding
+    static size_t storage_size(size_t d, size_t r, size_t c) {
+        size_t row = Storage::pitch(c, sizeof(T));
+        return d * Storage::pitch(r * row, sizeof(T));
+    }
+
+    // Get a pointer to the first element
+    T* get_data() { return data.data(); }
+    const T* get_data() const { return data.data(); }
+
+    // Resize to the given dimensions (contents are not preserved; storage is reused when the size is unchanged)
+    void resize(size_t d, size_t r, size_t c, uninitialised_t) {
+        if (d == depth && r == rows && c == cols) {
+            return;
+        }
+        depth = d;
+        rows = r;
+        cols = c;
+        set_pitches();
+        data.resize(d * slice_pitch);
+    }
+
+    // Get a view of the whole array
+    Array3DView<T> view() { return Array3DView<T>(*this); }
+    Array3DView<const T> view() const { return Array3DView<const T>(*this); }
+
+    // Get a view of the box of size (d, r, c) starting at (d0, r0, c0)
+    Array3DView<T> view(size_t d0, size_t r0, size_t c0, size_t d, size_t r, size_t c) {
+        return view().subview(d0, r0, c0, d, r, c);
+    }
+    Array3DView<const T> view(size_t d0, size_t r0, size_t c0, size_t d, size_t r, size_t c) const {
+        return view().subview(d0, r0, c0, d, r, c);
+    }
 
 };
 
-#endif // UTILS_H
\ No newline at end of file
+#endif // UTILS_H
@@ -0,0 +1,141 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include "utilities/utils.h"
+#include "utilities/parallel.h"
+#include <vector>
+
+using namespace std;
+
+/*
+ * Scratch memory and worker threads for the forward and inverse transforms
+ * Sized once from the volume dimensions, filter length and thread count, so that a
+ * process transforming many volumes of the same shape does no allocations after
+ * the first transform. The Convolve and Inverse passes draw their temporary copy
+ * and per-thread line buffers from here instead of allocating on every call.
+ */
+class DWTWorkspace {
+public:
+    DWTWorkspace(size_t depth, size_t rows, size_t cols, size_t filter_size, size_t threads = thread_count())
+        : pool(threads), filter_size(filter_size) {
+        reserve(depth, rows, cols);
+    }
+
+    // Grow the workspace (if needed) to hold volumes of the given dimensions
+    void reserve(size_t depth, size_t rows, size_t cols) {
+        if (depth * rows * cols > scratch.size()) {
+            scratch.resize(depth * rows * cols);
+        }
+
+        // One line buffer per thread, long enough for an input and an output line on any axis
+        size_t line_length = 2 * max(depth, max(rows, cols)) + filter_size;
+        if (lines.size() != pool.size() || lines[0].size() < line_length) {
+            lines.assign(pool.size(), vector<float, uninitialised_allocator<float, 64>>(line_length));
+        }
+
+        // Bounds for as many levels as the largest dimension allows
+        size_t max_levels = 1;
+        for (size_t n = max(depth, max(rows, cols)); n > 1; n = (n + 1) / 2) {
+            ++max_levels;
+        }
+        depth_levels.reserve(max_levels);
+        row_levels.reserve(max_levels);
+        col_levels.reserve(max_levels);
+    }
+
+    // Get the bytes of scratch memory a workspace for volumes of the given dimensions allocates
+    static size_t storage_bytes(size_t depth, size_t rows, size_t cols, size_t filter_size, size_t threads = thread_count()) {
+        size_t line_length = 2 * max(depth, max(rows, cols)) + filter_size;
+        return (depth * rows * cols + max<size_t>(1, threads) * line_length) * sizeof(float);
+    }
+
+    // Copy a view into the scratch volume and return the (packed) copy
+    Array3DView<float> copy_to_scratch(Array3DView<const float> data) {
+        size_t d = data.get_depth(), r = data.get_rows(), c = data.get_cols();
+        if (d * r * c > scratch.size()) {
+            scratch.resize(d * r * c);
+        }
+        Array3DView<float> temp(scratch.data(), d, r, c, r * c, c);
+        copy_view(data, temp);
+        return temp;
+    }
+
+    // Get the line buffer of a thread
+    float* line(size_t thread_id) { return lines[thread_id].data(); }
+
+    // Grow the scratch volume to hold a block of 'elements' floats for each thread (call before
+    // the parallel_for that uses scratch_block)
+    void reserve_blocks(size_t elements) {
+        if (pool.size() * elements > scratch.size()) {
+            scratch.resize(pool.size() * elements);
+        }
+    }
+
+    // Get the scratch block of a thread, of 'elements' floats as given to reserve_blocks
+    float* scratch_block(size_t thread_id, size_t elements) { return scratch.data() + thread_id * elements; }
+
+    /*
+     * Get the compact buffer of a level of the compact layout (see DWT::dwt_3d_compact)
+     * Each level from 1 on has its own packed buffer, grown on first use, so the LLL
+     * band a level works on is contiguous rather than a corner of the full volume.
+     * Parameters:
+     * - level: the level (1 for the LLL band of the first level)
+     * - depth, rows, cols: dimensions of the band
+     */
+    Array3DView<float> compact_level(size_t level, size_t depth, size_t rows, size_t cols) {
+        if (level >= compact.size()) {
+            compact.resize(level + 1);
+        }
+        if (depth * rows * cols > compact[level].size()) {
+            compact[level].resize(depth * rows * cols);
+        }
+        return Array3DView<float>(compact[level].data(), depth, rows, cols, rows * cols, cols);
+    }
+
+    // Get the bytes of the compact buffers of every level a volume of the given dimensions can have (an upper bound)
+    static size_t compact_bytes(size_t depth, size_t rows, size_t cols) {
+        size_t bytes = 0;
+        while (depth * rows * cols > 1) {
+            depth = (depth + 1) / 2;
+            rows = (rows + 1) / 2;
+            cols = (cols + 1) / 2;
+            bytes += depth * rows * cols * sizeof(float);
+        }
+        return bytes;
+    }
+
+    // Get the thread pool used for the passes
+    ThreadPool& threads() { return pool; }
+
+    // Per-level bounds used by the inverse transform
+    vector<size_t> depth_levels, row_levels, col_levels;
+
+private:
+    ThreadPool pool;
+    size_t filter_size;
+    vector<float, uninitialised_allocator<float, 64>> scratch;
+    vector<vector<float, uninitialised_allocator<float, 64>>> lines;
+    vector<vector<float, uninitialised_allocator<float, 64>>> compact;
+};
+
+// Copy a view for a pass, into the workspace if there is one, otherwise into 'local'
+inline Array3DView<float> scratch_copy(Array3DView<const float> data, DWTWorkspace* workspace, Array3D<float>& local) {
+    if (workspace) {
+        return workspace->copy_to_scratch(data);
+    }
+    local = Array3D<float>(data.get_depth(), data.get_rows(), data.get_cols(), uninitialised);
+    copy_view(data, local.view());
+    return local.view();
+}
+
+// Run func(i, thread_id) over [begin, end) on the workspace threads, or on new threads without one
+template <class Func>
+void parallel_for(DWTWorkspace* workspace, size_t begin, size_t end, Func func) {
+    if (workspace) {
+        workspace->threads().parallel_for(begin, end, func);
+    } else {
+        parallel_for(begin, end, func);
+    }
+}
+
+#endif // WORKSPACE_H
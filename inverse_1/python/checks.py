@@ -0,0 +1,105 @@
+import json
+import os
+import subprocess
+import sys
+import numpy as np
+import dwt_lib
+import subbands
+
+# Regression checks of the transforms (run from the repository with "make check", which builds DWT and the library first)
+
+# File number of the inputs the checks write for the DWT command (data/inputs/<number>_CT.bin)
+CHECK_NUMBER = 990
+
+# Largest error allowed when a float32 volume of magnitude ~100 is transformed and back
+TOLERANCE = 1e-3
+
+# Every wavelet reconstructs a volume exactly, including lines shorter than the filter and
+# extents that are odd from the start or become odd at a deeper level
+def check_round_trip():
+    rng = np.random.default_rng(1)
+    even = (((16, 16, 16), 1), ((16, 16, 16), 3), ((32, 24, 16), 2), ((2, 4, 6), 1))
+    odd = (((9, 16, 16), 2), ((16, 17, 16), 2), ((15, 15, 15), 2), ((20, 20, 20), 3))
+    for name in ('db1', 'db4', 'db8', 'sym4', 'coif2', 'bior2.2', 'bior4.4'):
+        wavelet = dwt_lib.Wavelet(name)
+        for shape, levels in even + (odd if name in ('db1', 'db4', 'sym4', 'bior4.4') else ()):
+            volume = rng.standard_normal(shape).astype(np.float32) * 100
+            error = np.abs(wavelet.inverse(wavelet.forward(volume, levels), levels) - volume).max()
+            if error > TOLERANCE:
+                return f'{name} {shape} with {levels} levels: round-trip error {error}'
+        wavelet.close()
+    return None
+
+# Run DWT on a volume or series written as input CHECK_NUMBER; returns its outputs (the reconstruction,
+# and the subbands and statistics when it writes them), read before they are removed
+def run_dwt(volume, filter_type, levels, *options):
+    base = f'{CHECK_NUMBER}_CT'
+    name = f'{base}_{filter_type}_{str(levels).replace(",", "-")}'
+    inputs = [f'data/inputs/{base}.bin', f'data/inputs/{base}_shape.txt']
+    files = {'coefficients': f'data/outputs/{name}.bin', 'reconstruction': f'data/outputs/inverse_{name}.bin',
+             'subbands': f'data/outputs/{name}_subbands.bin', 'stats': f'data/outputs/{name}_stats.json'}
+    os.makedirs('data/inputs', exist_ok=True)
+    os.makedirs('data/outputs', exist_ok=True)
+    try:
+        volume.astype(np.float32).tofile(inputs[0])
+        with open(inputs[1], 'w') as file:
+            file.write(','.join(str(n) for n in volume.shape))
+        result = subprocess.run(['./DWT', str(CHECK_NUMBER), 'CT', filter_type, str(levels), *options], capture_output=True, text=True)
+        if result.returncode != 0 or result.stderr:
+            raise RuntimeError(f'DWT {filter_type} {levels} {" ".join(options)} failed ({result.returncode}): {result.stderr.strip()}')
+        outputs = {'reconstruction': np.fromfile(files['reconstruction'], dtype=np.float32).reshape(volume.shape)}
+        if os.path.exists(files['subbands']):
+            outputs['subbands'] = subbands.read_subbands(files['subbands'])
+        if os.path.exists(files['stats']):
+            with open(files['stats']) as file:
+                outputs['stats'] = json.load(file)
+        return outputs
+    finally:
+        for filename in inputs + list(files.values()):
+            if os.path.exists(filename):
+                os.remove(filename)
+
+# A series whose deeper temporal levels are shorter than the filter is transformed and reconstructed
+def check_short_series():
+    series = np.random.default_rng(2).standard_normal((16, 8, 16, 16)).astype(np.float32) * 50
+    for filter_type, levels, time_levels in (('db4', 4, 4), ('db8', 1, 4), ('bior4.4', 2, 3)):
+        try:
+            reconstruction = run_dwt(series, filter_type, levels, f'--time-levels={time_levels}')['reconstruction']
+        except RuntimeError as error:
+            return str(error)
+        error = np.abs(reconstruction - series).max()
+        if error > TOLERANCE:
+            return f'{filter_type} with {levels} levels and {time_levels} temporal: round-trip error {error}'
+    return None
+
+# The statistics of every band match the bands of the subband file, for odd extents and every layout
+def check_stats_match_subbands():
+    rng = np.random.default_rng(3)
+    for shape, filter_type, levels, layout in (((5, 9, 7), 'db2', '2', 'linear'), ((5, 9, 7), 'db2', '2', 'compact'),
+                                               ((5, 9, 7), 'db2', '2', 'tiled'), ((9, 20, 22), 'db4', '2,3,1', 'linear'),
+                                               ((7, 11, 13), 'db1', '3', 'linear')):
+        volume = rng.standard_normal(shape).astype(np.float32) * 100
+        try:
+            outputs = run_dwt(volume, filter_type, levels, '--stats', f'--layout={layout}', '--no-tuning')
+        except RuntimeError as error:
+            return str(error)
+        for band in outputs['stats']['subbands']:
+            data = outputs['subbands'][(band['level'], band['tag'])].astype(np.float64)
+            energy = float(np.sum(data * data))
+            if band['count'] != data.size or abs(band['energy'] - energy) > 1e-5 * max(energy, 1.0):
+                return (f'{shape} {filter_type} {levels} {layout}: level {band["level"]} {band["tag"]} has energy {band["energy"]}'
+                        f' and {band["count"]} coefficients in the statistics, {energy} and {data.size} in the subband file')
+    return None
+
+CHECKS = [check_round_trip, check_short_series, check_stats_match_subbands]
+
+def main():
+    failed = 0
+    for check in CHECKS:
+        message = check()
+        print(f'{check.__name__}: {"FAILED, " + message if message else "ok"}')
+        failed += message is not None
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -92,6 +92,15 @@ while not dataset_exists(dicom_directory):
 
 print(dicom_directory)
 
+# Loop until a valid input for the stored sample type is provided
+while True:
+    native_input = input("\nKeep native 16-bit samples (yes) or convert to float32 (no)? : ").strip().lower()
+    if native_input in ['yes', 'no']:
+        keep_native = native_input == 'yes'
+        break
+    else:
+        print("Invalid input. Please enter 'yes' or 'no'.")
+
 # Function to read DICOM files into a single 3D numpy array
 def read_dicom_files(directory):
     dicom_files = []
@@ -99,7 +108,9 @@ def read_dicom_files(directory):
         if filename.endswith(".dcm"):
             filepath = os.path.join(directory, filename)
             dicom_data = pydicom.dcmread(filepath)
-            pixel_array = dicom_data.pixel_array.astype(np.float32) 
+            pixel_array = dicom_data.pixel_array
+            if not (keep_native and pixel_array.dtype in (np.int16, np.uint16)):
+                pixel_array = pixel_array.astype(np.float32)
             dicom_files.append(pixel_array)
     dicom_data = np.array(dicom_files)
     print(f"Shape of the 3D DICOM data: {dicom_data.shape}")
@@ -115,6 +126,9 @@ def dicom_to_binary(dicom_directory, binary_file_path, shape_file_path):
     dicom_data.tofile(binary_file_path)
     with open(shape_file_path, 'w') as f:
         f.write(','.join(map(str, dicom_data.shape)))
+        # Record the sample type so that IO::read can widen 16-bit data on load
+        if dicom_data.dtype != np.float32:
+            f.write(',' + str(dicom_data.dtype))
     print(f"Data saved to {binary_file_path} and shape saved to {shape_file_path}")
 
 # Extract the number from the directory path
@@ -0,0 +1,61 @@
+import socket
+import struct
+import numpy as np
+
+# Request and response headers of the DWT service (see include/server.h)
+REQUEST_FORMAT = '<4s3I3Q16sfI'
+RESPONSE_FORMAT = '<4sI4Qd'
+
+JOBS = {'transform': 1, 'inverse': 2, 'denoise': 3}
+
+# Connection to a DWT service started with "DWT --serve=<socket path>"; one connection serves many requests
+class Client:
+    def __init__(self, path='/tmp/dwt.sock'):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+
+    def close(self):
+        self.sock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def _read(self, length):
+        data = bytearray(length)
+        view = memoryview(data)
+        while length > 0:
+            n = self.sock.recv_into(view, length)
+            if n == 0:
+                raise ConnectionError('DWT service closed the connection')
+            view = view[n:]
+            length -= n
+        return data
+
+    # Run a job on a 3D volume; returns the result, or None if it was written to output_path
+    def run(self, job, volume, filter_type='db1', levels=1, threshold=-1.0, output_path=''):
+        volume = np.ascontiguousarray(volume, dtype=np.float32)
+        path = output_path.encode()
+        header = struct.pack(REQUEST_FORMAT, b'DWTQ', 1, JOBS[job], levels, *volume.shape,
+                             filter_type.encode(), threshold, len(path))
+        self.sock.sendall(header + path)
+        self.sock.sendall(memoryview(volume).cast('B'))
+
+        magic, status, depth, rows, cols, payload, seconds = struct.unpack(RESPONSE_FORMAT, self._read(struct.calcsize(RESPONSE_FORMAT)))
+        body = self._read(payload)
+        if status != 0:
+            raise RuntimeError(body.decode())
+        if not payload:
+            return None
+        return np.frombuffer(body, dtype=np.float32).reshape(depth, rows, cols)
+
+    def transform(self, volume, filter_type='db1', levels=1, output_path=''):
+        return self.run('transform', volume, filter_type, levels, output_path=output_path)
+
+    def inverse(self, coefficients, filter_type='db1', levels=1, output_path=''):
+        return self.run('inverse', coefficients, filter_type, levels, output_path=output_path)
+
+    def denoise(self, volume, filter_type='db1', levels=1, threshold=-1.0, output_path=''):
+        return self.run('denoise', volume, filter_type, levels, threshold, output_path)
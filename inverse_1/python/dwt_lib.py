@@ -0,0 +1,99 @@
+import ctypes
+import os
+import numpy as np
+
+# In-process binding of libdwt (build it with "make lib"); arrays are passed by pointer and strides, without copies
+
+_STRIDES = ctypes.c_ssize_t * 3
+_DIMS = ctypes.c_size_t * 3
+_FLOAT_P = ctypes.POINTER(ctypes.c_float)
+
+# Load the library from LIBDWT_PATH, next to the repository root, or from the loader path
+def _load():
+    path = os.environ.get('LIBDWT_PATH', os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'libdwt.so'))
+    lib = ctypes.CDLL(path if os.path.exists(path) else 'libdwt.so')
+
+    lib.dwt_api_version.restype = ctypes.c_int
+    lib.dwt_last_error.restype = ctypes.c_char_p
+    lib.dwt_create.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.dwt_create.restype = ctypes.c_void_p
+    lib.dwt_destroy.argtypes = [ctypes.c_void_p]
+    transform = [ctypes.c_void_p, _FLOAT_P, _STRIDES, _FLOAT_P, _STRIDES, _DIMS, ctypes.c_int]
+    for name in ('dwt_forward', 'dwt_inverse'):
+        getattr(lib, name).argtypes = transform
+        getattr(lib, name).restype = ctypes.c_int
+    lib.dwt_update.argtypes = [ctypes.c_void_p, _FLOAT_P, _STRIDES] + transform[1:] + [ctypes.POINTER(ctypes.c_size_t), ctypes.c_size_t]
+    lib.dwt_update.restype = ctypes.c_int
+    lib.dwt_denoise.argtypes = transform + [ctypes.c_float, ctypes.POINTER(ctypes.c_float)]
+    lib.dwt_denoise.restype = ctypes.c_int
+
+    if lib.dwt_api_version() != 1:
+        raise RuntimeError(f'{path} has interface version {lib.dwt_api_version()}, expected 1')
+    return lib
+
+_lib = None
+
+# Pointer and element strides of a float32 array (any memory order); raises instead of copying
+def _describe(array, name):
+    if not isinstance(array, np.ndarray) or array.dtype != np.float32 or array.ndim != 3:
+        raise TypeError(f'{name} must be a 3D float32 NumPy array')
+    if any(s < 0 or s % 4 for s in array.strides):
+        raise ValueError(f'{name} must have positive strides that are whole elements')
+    return array.ctypes.data_as(_FLOAT_P), _STRIDES(*(s // 4 for s in array.strides))
+
+# Wavelet transforms of one filter, keeping their threads and scratch memory between calls
+class Wavelet:
+    def __init__(self, filter_type='db1', threads=0):
+        global _lib
+        if _lib is None:
+            _lib = _load()
+        self._context = _lib.dwt_create(filter_type.encode(), threads)
+        if not self._context:
+            raise ValueError(_lib.dwt_last_error().decode())
+
+    def close(self):
+        if self._context:
+            _lib.dwt_destroy(self._context)
+            self._context = None
+
+    def __del__(self):
+        self.close()
+
+    def _call(self, func, volume, out, levels, *extra):
+        if out is None:
+            out = np.empty(volume.shape, dtype=np.float32)
+        elif out.shape != volume.shape:
+            raise ValueError('out must have the shape of the input')
+        src, src_strides = _describe(volume, 'volume')
+        dst, dst_strides = _describe(out, 'out')
+        if func(self._context, src, src_strides, dst, dst_strides, _DIMS(*volume.shape), levels, *extra) != 0:
+            raise RuntimeError(_lib.dwt_last_error().decode())
+        return out
+
+    # Forward transform; pass out=volume to transform in place
+    def forward(self, volume, levels=1, out=None):
+        return self._call(_lib.dwt_forward, volume, out, levels)
+
+    # Inverse transform of coefficients from forward
+    def inverse(self, coefficients, levels=1, out=None):
+        return self._call(_lib.dwt_inverse, coefficients, out, levels)
+
+    # Update the coefficients of forward in place after the depth slices 'changed' of the volume went from
+    # previous to current (both len(changed) x rows x cols); returns the coefficients
+    def update(self, coefficients, changed, previous, current, levels=1):
+        if previous.shape != current.shape or previous.shape != (len(changed),) + coefficients.shape[1:]:
+            raise ValueError('previous and current must hold one slice of the volume per changed index')
+        old, old_strides = _describe(previous, 'previous')
+        new, new_strides = _describe(current, 'current')
+        dst, dst_strides = _describe(coefficients, 'coefficients')
+        slices = (ctypes.c_size_t * len(changed))(*changed)
+        if _lib.dwt_update(self._context, old, old_strides, new, new_strides, dst, dst_strides,
+                           _DIMS(*coefficients.shape), levels, slices, len(changed)) != 0:
+            raise RuntimeError(_lib.dwt_last_error().decode())
+        return coefficients
+
+    # Soft-threshold denoising (universal threshold if threshold is negative); returns the result and the threshold used
+    def denoise(self, volume, levels=1, threshold=-1.0, out=None):
+        applied = ctypes.c_float()
+        out = self._call(_lib.dwt_denoise, volume, out, levels, ctypes.c_float(threshold), ctypes.byref(applied))
+        return out, applied.value
@@ -0,0 +1,34 @@
+import struct
+import numpy as np
+
+# Size of the fixed header and of each index record written by IO::export_subbands
+HEADER_FORMAT = '<4sI3QII'
+RECORD_FORMAT = '<I4sQ3Q'
+
+# Read the index of a multi-level subband file
+def read_index(filename):
+    with open(filename, 'rb') as file:
+        magic, version, depth, rows, cols, levels, count = struct.unpack(HEADER_FORMAT, file.read(struct.calcsize(HEADER_FORMAT)))
+        if magic != b'DWTS' or version != 1:
+            raise ValueError(f'{filename} is not a subband file')
+
+        records = []
+        for _ in range(count):
+            level, tag, offset, d, r, c = struct.unpack(RECORD_FORMAT, file.read(struct.calcsize(RECORD_FORMAT)))
+            records.append({'level': level, 'tag': tag.rstrip(b'\0').decode(), 'offset': offset, 'shape': (d, r, c)})
+
+    return (depth, rows, cols), levels, records
+
+# Read the subbands of the requested levels only (all levels if None)
+def read_subbands(filename, levels=None):
+    _, _, records = read_index(filename)
+    subbands = {}
+    with open(filename, 'rb') as file:
+        for record in records:
+            if levels is not None and record['level'] not in levels:
+                continue
+            file.seek(record['offset'])
+            count = int(np.prod(record['shape']))
+            subbands[(record['level'], record['tag'])] = np.fromfile(file, dtype=np.float32, count=count).reshape(record['shape'])
+
+    return subbands
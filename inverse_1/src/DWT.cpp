@@ -1,114 +1,372 @@
 #include "DWT.h"
+#include <map>
+#include <set>
 
 // Constructor for the DWT class to be used for convolving the filters
 DWT::DWT(const float* lpf, const float* hpf, size_t filter_size)
     : convolve(lpf, hpf, filter_size) {}
 
 /* 
- * Perform the 3D Discrete Wavelet Transform on the input data and export the result
+ * Perform the convolutions of the Multi-Level 3D Discrete Wavelet Transform
  * Parameters:
- * - binary_filename: the name of the binary file containing the input data
- * - output_filename: the name of the binary file to write the transformed data to
- * - filter_type: the type of wavelet filter to use (e.g., "haar", "db1")
- * - levels: the number of levels of decomposition
+ * - data: 3D array of data to be transformed
+ * - levels: number of levels of decomposition (along each axis)
+ * Returns:
+ * - 3D array of transformed data
  */
-void perform_transform(const string& binary_filename, const string& output_filename, const string& filter_type, int levels) {
-    // Choose the wavelet filters based on user input
-    const float* lpf;
-    const float* hpf;
-    const float* Ilpf;
-    const float* Ihpf;
-    size_t filter_size;
-    
-    // Determine the shape file based on the binary file name
-    string shape_filename = binary_filename.substr(0, binary_filename.find_last_of('.')) + "_shape.txt";
-
-    if (!get_filters(filter_type, lpf, hpf, Ilpf, Ihpf, filter_size)) {
-        cerr << "Failed to get filters for type: " << filter_type << endl;
-        return;
-    }
+Array3D<float> DWT::dwt_3d(const Array3D<float>& data, const AxisLevels& levels) const {
+    // Create the result and a workspace sized for this volume
+    Array3D<float> result;
+    DWTWorkspace workspace(data.get_depth(), data.get_rows(), data.get_cols(), convolve.get_filter_size());
 
-    try {
-        // Read the DICOM data into an array
-        Array3D<float> dicom_data = IO::read(binary_filename, shape_filename);
+    dwt_3d(data, result, levels, workspace);
+
+    // Return the transformed data
+    return result;
+}
 
-        cout << "\nData read from " << binary_filename << " successfully.\n" << endl;
+/* 
+ * Perform the Multi-Level 3D Discrete Wavelet Transform into a caller-owned array
+ * Parameters:
+ * - data: 3D array of data to be transformed
+ * - result: 3D array to store the transformed data (resized if needed)
+ * - levels: number of levels of decomposition (along each axis)
+ * - workspace: scratch memory and threads for the convolution passes
+ * - statistics: subband statistics to add each level to, or nullptr
+ */
+void DWT::dwt_3d(const Array3D<float>& data, Array3D<float>& result, const AxisLevels& levels, DWTWorkspace& workspace,
+                 SubbandStatistics* statistics) const {
+    result.resize(data.get_depth(), data.get_rows(), data.get_cols(), uninitialised);
+    dwt_3d(data.view(), result.view(), levels, workspace, statistics);
+}
 
-        // Print the characteristics of the input data
-        cout << "Filter type: " << filter_type << endl;
-        cout << "Filter size: " << filter_size << endl;
-        cout << "Levels: " << levels << endl;
+/* 
+ * Perform the Multi-Level 3D Discrete Wavelet Transform into a view of caller-owned memory
+ * Parameters:
+ * - data: view of the data to be transformed (any strides)
+ * - result: view to store the transformed data, of the same dimensions (any strides); it may
+ *   be the same memory as data, with the same strides, to transform in place
+ * - levels: number of levels of decomposition along each axis; an axis is only
+ *   convolved (and its bounds only halved) at the levels it has
+ * - workspace: scratch memory and threads for the convolution passes
+ * - statistics: subband statistics to add each level to as soon as its bands are final, or nullptr
+ */
+void DWT::dwt_3d(Array3DView<const float> data, Array3DView<float> result, const AxisLevels& levels, DWTWorkspace& workspace,
+                 SubbandStatistics* statistics) const {
+    // Copy the input data into the result, which is transformed in place
+    if (!same_layout(data, result)) {
+        copy_view(data, result);
+    }
+    workspace.reserve(data.get_depth(), data.get_rows(), data.get_cols());
 
-        // Create a DWT object to store filter information
-        DWT dwt(lpf, hpf, filter_size);
+    // Calculate the bounds of each level's LLL subband
+    vector<size_t>& depth_levels = workspace.depth_levels;
+    vector<size_t>& row_levels = workspace.row_levels;
+    vector<size_t>& col_levels = workspace.col_levels;
+    level_bounds(data.get_depth(), data.get_rows(), data.get_cols(), levels, depth_levels, row_levels, col_levels);
 
-        // Measure the time taken for the 3D wavelet transform
-        double start_time = jbutil::gettime();
+    for (int level = 0; level < levels.max(); ++level) {
+        PROFILE_SCOPE("level", level + 1);
+        // Convolve and subsample ONLY within the bounds of the current level
+        Array3DView<float> bounds = result.subview(0, 0, 0, depth_levels[level], row_levels[level], col_levels[level]);
+        transform_level(bounds, levels, level, &workspace);
 
-        // Perform the 3D wavelet transform with the desired number of levels
-        Array3D<float> wavelet_3d = dwt.dwt_3d(dicom_data, levels);
+        // Add the bands no deeper level reaches into (see SubbandStatistics)
+        if (statistics) {
+            statistics->add_level(result, level + 1, workspace.threads());
+        }
+    }
+}
 
-        double end_time = jbutil::gettime();
-        double elapsed_time = end_time - start_time;
+/* 
+ * Perform the convolutions of one level within its bounds, skipping the axes whose levels are used up
+ * Parameters:
+ * - bounds: view of the region transformed at this level
+ * - levels: number of levels of decomposition along each axis
+ * - level: the level (from 0)
+ * - workspace: scratch memory and threads for the convolution passes
+ */
+void DWT::transform_level(Array3DView<float> bounds, const AxisLevels& levels, int level, DWTWorkspace* workspace) const {
+    if (levels.splits(0, level)) {
+        convolve.dim0(bounds, workspace); // Convolve along the first dimension (rows)
+    }
+    if (levels.splits(1, level)) {
+        convolve.dim1(bounds, workspace); // Convolve along the second dimension (columns)
+    }
+    if (levels.splits(2, level)) {
+        convolve.dim2(bounds, workspace); // Convolve along the third dimension (depths)
+    }
+}
 
-        cout << "Time taken for 3D Wavelet Transform: " << elapsed_time << " seconds\n" << endl;
+/*
+ * Update the coefficients of a transform after some depth slices of its input changed
+ * The transform is linear, so the coefficients of the changed volume are the old ones
+ * plus the transform of the change (the new slices minus the old ones, zero elsewhere).
+ * The row and column passes of a level stay within each slice, so only the depth pass
+ * spreads a change: output i of a level (low at i, high at half + i) reads inputs
+ * 2i to 2i + taps - 1 of the level, wrapping around. Each level transforms only the
+ * changed slices, makes only the outputs they reach, adds those to the coefficients
+ * and passes on the changed corners the next level transforms further. The work is
+ * proportional to the changed slices (plus the filter length) at every level, not to
+ * the volume; the sums are in a different order from a full transform, so the result
+ * matches one to rounding rather than bit for bit.
+ * Parameters:
+ * - previous, current: the changed slices before and after the change, one per index
+ *   of changed_slices (changed_slices.size() x rows x cols)
+ * - coefficients: the coefficients of the transform of the volume before the change,
+ *   brought up to date in place
+ * - changed_slices: the depth indices of the changed slices (no repeats)
+ * - levels: the levels the coefficients were transformed with
+ * - workspace: scratch memory and threads
+ */
+void DWT::dwt_3d_update(Array3DView<const float> previous, Array3DView<const float> current, Array3DView<float> coefficients,
+                        const vector<size_t>& changed_slices, const AxisLevels& levels, DWTWorkspace& workspace) const {
+    PROFILE_SCOPE("update");
+    size_t depth = coefficients.get_depth(), rows = coefficients.get_rows(), cols = coefficients.get_cols();
+    for (Array3DView<const float> slices : {previous, current}) {
+        if (slices.get_depth() != changed_slices.size() || slices.get_rows() != rows || slices.get_cols() != cols) {
+            throw runtime_error("The changed slices must be one " + to_string(rows) + "x" + to_string(cols) + " slice per changed index");
+        }
+    }
 
-        // Export the transformed data to a binary file
-        IO::export_data(wavelet_3d, output_filename);
+    // The change of each changed slice, the inputs of the first level
+    map<size_t, Array3D<float>> inputs;
+    for (size_t s = 0; s < changed_slices.size(); ++s) {
+        size_t z = changed_slices[s];
+        if (z >= depth) {
+            throw runtime_error("Changed slice " + to_string(z) + " is outside the volume of depth " + to_string(depth));
+        }
+        if (inputs.count(z)) {
+            throw runtime_error("Changed slice " + to_string(z) + " is given more than once");
+        }
+        Array3D<float>& change = inputs[z] = Array3D<float>(1, rows, cols, uninitialised);
+        for (size_t r = 0; r < rows; ++r) {
+            for (size_t c = 0; c < cols; ++c) {
+                change(0, r, c) = current(s, r, c) - previous(s, r, c);
+            }
+        }
+    }
 
-        cout << "Data exported to " << output_filename << " successfully.\n" << endl;
+    vector<size_t> depth_levels, row_levels, col_levels;
+    level_bounds(depth, rows, cols, levels, depth_levels, row_levels, col_levels);
+    const int count = levels.max();
+    const size_t taps = convolve.get_filter_size();
 
-        // Create an Inverse object to store filter information
-        Inverse inverse(Ilpf, Ihpf, filter_size);
+    for (int level = 0; level < count && !inputs.empty(); ++level) {
+        PROFILE_SCOPE("level", level + 1);
+        size_t half = depth_levels[level] / 2, even = 2 * half;
+        size_t r = row_levels[level], c = col_levels[level];
+        bool split = levels.splits(2, level);
 
-        // Perform the inverse 3D wavelet transform
-        Array3D<float> reconstructed_data = inverse.inverse_dwt_3d(wavelet_3d, levels);
+        // Row and column passes of the changed slices, a slice per thread at a time
+        vector<Array3D<float>*> slices;
+        for (auto& input : inputs) {
+            slices.push_back(&input.second);
+        }
+        workspace.reserve_blocks(r * c);
+        workspace.threads().parallel_for(0, slices.size(), [&](size_t s, size_t t) {
+            float* scratch = workspace.scratch_block(t, r * c);
+            if (levels.splits(0, level)) {
+                convolve.dim_serial(slices[s]->view(), 0, scratch);
+            }
+            if (levels.splits(1, level)) {
+                convolve.dim_serial(slices[s]->view(), 1, scratch);
+            }
+        });
 
-        // Determine the inverse output filename
-        std::string inverse_output_filename = "data/outputs/inverse_" + output_filename.substr(output_filename.find_last_of('/') + 1);
-    
-        // Export the reconstructed data to a binary file
-        IO::export_inverse(reconstructed_data, inverse_output_filename);
+        // The outputs the changed inputs reach: output i reads input k when 2i + j = k (modulo the
+        // even part of the depth) for a tap j, and an odd last input (or any input of a level that
+        // does not split the depth) is passed through as it is
+        set<size_t> reached;
+        for (const auto& input : inputs) {
+            size_t k = input.first;
+            if (!split || k >= even) {
+                reached.insert(k);
+                continue;
+            }
+            for (size_t j = 0; j < taps; ++j) {
+                size_t m = (k + even - j % even) % even;
+                if (m % 2 == 0 && m / 2 < half) {
+                    reached.insert(m / 2);
+                    reached.insert(half + m / 2);
+                }
+            }
+        }
 
-        cout << "Inverse 3D Wavelet Transform completed successfully." << endl;
-        cout << "Data exported to " << inverse_output_filename << " successfully." << endl;
+        // Depth pass of the change into each output it reaches
+        map<size_t, Array3D<float>> outputs;
+        vector<pair<size_t, Array3D<float>*>> targets;
+        for (size_t z : reached) {
+            targets.emplace_back(z, &(outputs[z] = Array3D<float>(1, r, c)));
+        }
+        workspace.threads().parallel_for(0, targets.size(), [&](size_t s, size_t) {
+            size_t z = targets[s].first;
+            Array3D<float>& out = *targets[s].second;
+            if (!split || z >= even) {
+                copy_view(inputs.at(z).view(), out.view());
+                return;
+            }
+            size_t i = z < half ? z : z - half;
+            const float* filter = z < half ? convolve.get_lpf() : convolve.get_hpf();
+            for (size_t j = 0; j < taps; ++j) {
+                auto input = inputs.find((2 * i + j) % even);
+                if (input == inputs.end()) {
+                    continue;
+                }
+                for (size_t row = 0; row < r; ++row) {
+                    const float* x = &input->second(0, row, 0);
+                    float* y = &out(0, row, 0);
+                    for (size_t col = 0; col < c; ++col) {
+                        y[col] += filter[j] * x[col];
+                    }
+                }
+            }
+        });
 
-    } catch (const runtime_error& e) {
-        cerr << "Runtime error: " << e.what() << endl;
-        return;
+        // Add the change to the coefficients, except the corner the next level transforms further,
+        // which becomes the change of the next level
+        bool deeper = level + 1 < count;
+        size_t next_d = deeper ? depth_levels[level + 1] : 0;
+        size_t next_r = deeper ? row_levels[level + 1] : 0, next_c = deeper ? col_levels[level + 1] : 0;
+        inputs.clear();
+        for (auto& output : outputs) {
+            size_t z = output.first;
+            const Array3D<float>& change = output.second;
+            bool corner = z < next_d;
+            for (size_t row = 0; row < r; ++row) {
+                size_t first = corner && row < next_r ? next_c : 0;
+                for (size_t col = first; col < c; ++col) {
+                    coefficients(z, row, col) += change(0, row, col);
+                }
+            }
+            if (corner) {
+                Array3D<float>& next = inputs[z] = Array3D<float>(1, next_r, next_c, uninitialised);
+                copy_view(change.view().subview(0, 0, 0, 1, next_r, next_c), next.view());
+            }
+        }
     }
 }
 
+/* 
+ * Perform the Multi-Level 3D Discrete Wavelet Transform in place on a tiled array
+ * Parameters:
+ * - data: tiled 3D array of data to be transformed
+ * - levels: number of levels of decomposition (along each axis)
+ * - workspace: optional line buffers and threads for the convolution passes
+ */
+void DWT::dwt_3d(TiledArray3D<float>& data, const AxisLevels& levels, DWTWorkspace* workspace) const {
+    vector<size_t> depth_levels, row_levels, col_levels;
+    level_bounds(data.get_depth(), data.get_rows(), data.get_cols(), levels, depth_levels, row_levels, col_levels);
+
+    for (int level = 0; level < levels.max(); ++level) {
+        PROFILE_SCOPE("level", level + 1);
+        for (int axis = 0; axis < 3; ++axis) {
+            if (levels.splits(axis, level)) {
+                // Convolve along the rows, then the columns, then the depths
+                convolve.dim(data, axis, depth_levels[level], row_levels[level], col_levels[level], workspace);
+            }
+        }
+    }
+}
 
 /* 
- * Perform the convolutions of the Multi-Level 3D Discrete Wavelet Transform
+ * Perform the Multi-Level 3D Discrete Wavelet Transform with the compact layout
+ * From level 2 on, dwt_3d works on the top-left corner of the full volume with the
+ * full row and slice pitch, so the deep levels touch a few elements of many cache lines
+ * and pages. Here the LLL band is copied into a packed buffer of its own before each
+ * deeper level (a Mallat-style pyramid of buffers in the workspace), and the bands are
+ * copied back from the deepest up once every level is done, so the result is the same.
  * Parameters:
- * - data: 3D array of data to be transformed
- * - levels: number of levels of decomposition
- * Returns:
- * - 3D array of transformed data
+ * - data: view of the data to be transformed (any strides)
+ * - result: view to store the transformed data, of the same dimensions; it may be data
+ * - levels: number of levels of decomposition (along each axis)
+ * - workspace: scratch memory, level buffers and threads for the convolution passes
  */
-Array3D<float> DWT::dwt_3d(const Array3D<float>& data, int levels) const {
-    // Create a copy of the input data to store the result
-    Array3D<float> result = data;
+void DWT::dwt_3d_compact(Array3DView<const float> data, Array3DView<float> result, const AxisLevels& levels, DWTWorkspace& workspace) const {
+    if (!same_layout(data, result)) {
+        copy_view(data, result);
+    }
+    workspace.reserve(data.get_depth(), data.get_rows(), data.get_cols());
+
+    // Calculate the bounds of each level
+    vector<size_t>& depth_levels = workspace.depth_levels;
+    vector<size_t>& row_levels = workspace.row_levels;
+    vector<size_t>& col_levels = workspace.col_levels;
+    level_bounds(data.get_depth(), data.get_rows(), data.get_cols(), levels, depth_levels, row_levels, col_levels);
+
+    // The band transformed at a level: the whole result at the first, its own buffer after that
+    auto band = [&](int level) {
+        return level == 0 ? result : workspace.compact_level(level, depth_levels[level], row_levels[level], col_levels[level]);
+    };
+
+    Array3DView<float> parent = result;
+    for (int level = 0; level < levels.max(); ++level) {
+        PROFILE_SCOPE("level", level + 1);
+        Array3DView<float> bounds = band(level);
+        if (level > 0) {
+            copy_view(parent.subview(0, 0, 0, depth_levels[level], row_levels[level], col_levels[level]), bounds);
+        }
+        transform_level(bounds, levels, level, &workspace);
+        parent = bounds;
+    }
+
+    // Put each level's coefficients back into the LLL corner of the level above
+    for (int level = levels.max() - 1; level > 0; --level) {
+        copy_view(band(level), band(level - 1).subview(0, 0, 0, depth_levels[level], row_levels[level], col_levels[level]));
+    }
+}
 
-    // Get the initial dimensions of the data
+/* 
+ * Perform the Multi-Level 2D Discrete Wavelet Transform of every depth slice
+ * Each slice is transformed on its own along the rows and columns, by one thread from
+ * its first level to its last, so there is no barrier between passes or levels and
+ * the slice stays in that thread's cache. The slices are shared out in contiguous chunks.
+ * With fewer slices than threads (an image has one to four), the levels run one after
+ * another instead, with the lines of every slice shared out in each pass.
+ * Parameters:
+ * - data: view of the slices to be transformed (any strides)
+ * - result: view to store the transformed slices, of the same dimensions; it may be data
+ * - levels: number of levels of decomposition of each slice
+ * - workspace: scratch blocks (one slice per thread) and threads
+ */
+void DWT::dwt_2d(Array3DView<const float> data, Array3DView<float> result, int levels, DWTWorkspace& workspace) const {
+    if (!same_layout(data, result)) {
+        copy_view(data, result);
+    }
     size_t depth = data.get_depth();
     size_t rows = data.get_rows();
     size_t cols = data.get_cols();
+    workspace.reserve(depth, rows, cols);
 
+    vector<size_t>& depth_levels = workspace.depth_levels;
+    vector<size_t>& row_levels = workspace.row_levels;
+    vector<size_t>& col_levels = workspace.col_levels;
+    level_bounds(depth, rows, cols, AxisLevels(levels, levels, 0), depth_levels, row_levels, col_levels);
+
+    // With fewer slices than threads, the lines of each pass are shared out instead
+    if (depth < workspace.threads().size()) {
+        for (int level = 0; level < levels; ++level) {
+            Array3DView<float> bounds = result.subview(0, 0, 0, depth, row_levels[level], col_levels[level]);
+            convolve.dim1(slice_lines(bounds, 0), &workspace); // Convolve along the rows
+            convolve.dim1(slice_lines(bounds, 1), &workspace); // Convolve along the columns
+        }
+        return;
+    }
+    workspace.reserve_blocks(rows * cols);
+
+    // Each pass of each level copies and transforms every element of its band once
     for (int level = 0; level < levels; ++level) {
-        // Convolve and subsample ONLY within the bounds of the current level
-        convolve.dim0(result, depth, rows, cols); // Convolve along the first dimension (rows)
-        convolve.dim1(result, depth, rows, cols); // Convolve along the second dimension (columns)
-        convolve.dim2(result, depth, rows, cols); // Convolve along the third dimension (depths)
-
-        // Calculate new bounds for the next level's LLL subband
-        depth = (depth+1) / 2;
-        rows = (rows+1) / 2;
-        cols = (cols+1) / 2;
+        size_t band = depth * row_levels[level] * col_levels[level];
+        Profiler::add_work(8.0 * sizeof(float) * band, kernel_flops(depth * col_levels[level], row_levels[level], convolve.get_filter_size()) +
+                                                       kernel_flops(depth * row_levels[level], col_levels[level], convolve.get_filter_size()));
     }
 
-    // Return the transformed data
-    return result;
-}
\ No newline at end of file
+    workspace.threads().parallel_for(0, depth, [&](size_t d, size_t t) {
+        float* scratch = workspace.scratch_block(t, rows * cols);
+        for (int level = 0; level < levels; ++level) {
+            Array3DView<float> bounds = result.subview(d, 0, 0, 1, row_levels[level], col_levels[level]);
+            convolve.dim_serial(bounds, 0, scratch); // Convolve along the rows
+            convolve.dim_serial(bounds, 1, scratch); // Convolve along the columns
+        }
+    });
+}
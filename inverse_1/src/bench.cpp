@@ -0,0 +1,277 @@
+#include "DWT.h"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+// Settings of a benchmark run, set from "--name=value" options
+struct BenchOptions {
+    vector<array<size_t, 3>> sizes = {{64, 64, 64}, {128, 128, 128}};
+    vector<string> filters = {"db1", "db2", "db3", "db4", "db5", "db6", "db7", "db8"};
+    vector<int> levels = {1, 2, 3};
+    vector<string> stages = {"forward", "inverse", "io"};
+    int warmup = 1;          // untimed runs before each measurement
+    int repetitions = 5;     // timed runs per measurement
+    string format = "csv";   // csv or json
+    string output;           // file to write the results to (standard output if empty)
+};
+
+// Summary statistics of the timed runs of one measurement
+struct BenchResult {
+    array<size_t, 3> size;
+    string filter;
+    int levels;
+    string stage;
+    size_t repetitions;
+    double min, median, p10, p90, mean; // seconds
+};
+
+// Split a comma separated list
+static vector<string> split(const string& list, char separator = ',') {
+    vector<string> items;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, separator)) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// Parse a volume size given as DEPTHxROWSxCOLS
+static array<size_t, 3> parse_size(const string& text) {
+    vector<string> dims = split(text, 'x');
+    if (dims.size() != 3) {
+        throw invalid_argument("Volume size must be DEPTHxROWSxCOLS: " + text);
+    }
+    return {stoul(dims[0]), stoul(dims[1]), stoul(dims[2])};
+}
+
+// Parse a count given to an option, rejecting values below the least it allows
+static int parse_count(const string& name, const string& value, int least) {
+    size_t end = 0;
+    int count = stoi(value, &end);
+    if (end != value.size() || count < least) {
+        throw invalid_argument("--" + name + " must be a whole number of at least " + to_string(least) + ": " + value);
+    }
+    return count;
+}
+
+// Get the value at a fraction of the way through sorted samples (linear interpolation)
+static double percentile(const vector<double>& sorted, double fraction) {
+    double pos = fraction * (sorted.size() - 1);
+    size_t lower = static_cast<size_t>(pos);
+    size_t upper = min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (pos - lower) * (sorted[upper] - sorted[lower]);
+}
+
+// Create a synthetic volume: smooth structure plus deterministic noise, in the range of CT values
+static Array3D<float> synthetic_volume(size_t depth, size_t rows, size_t cols) {
+    Array3D<float> volume(depth, rows, cols, uninitialised);
+    uint32_t state = 12345;
+    for (size_t d = 0; d < depth; ++d) {
+        for (size_t r = 0; r < rows; ++r) {
+            for (size_t c = 0; c < cols; ++c) {
+                state = state * 1664525u + 1013904223u; // LCG
+                float noise = static_cast<float>(state >> 8) / 16777216.0f - 0.5f;
+                volume(d, r, c) = 1000.0f * sinf(0.05f * d) * cosf(0.03f * r) + 500.0f * sinf(0.07f * c) + 50.0f * noise;
+            }
+        }
+    }
+    return volume;
+}
+
+/*
+ * Time a stage: run it 'warmup' times untimed, then 'repetitions' times timed
+ * Parameters:
+ * - run: the stage to time
+ * - options: warm-up and repetition counts
+ * Returns:
+ * - the sorted run times in seconds
+ */
+template <class Func>
+static vector<double> time_runs(Func run, const BenchOptions& options) {
+    for (int i = 0; i < options.warmup; ++i) {
+        run();
+    }
+    vector<double> times;
+    for (int i = 0; i < options.repetitions; ++i) {
+        auto start = chrono::steady_clock::now();
+        run();
+        times.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    sort(times.begin(), times.end());
+    return times;
+}
+
+// Summarise the run times of one measurement
+static BenchResult summarise(const array<size_t, 3>& size, const string& filter, int levels, const string& stage, const vector<double>& times) {
+    double total = 0.0;
+    for (double t : times) {
+        total += t;
+    }
+    return BenchResult{size, filter, levels, stage, times.size(),
+                       times.front(), percentile(times, 0.5), percentile(times, 0.1), percentile(times, 0.9), total / times.size()};
+}
+
+// Write the results as CSV (one row per measurement) or as a JSON array
+static void write_results(ostream& out, const vector<BenchResult>& results, const string& format) {
+    out << setprecision(9);
+    if (format == "json") {
+        out << "[\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            double voxels = static_cast<double>(r.size[0]) * r.size[1] * r.size[2];
+            out << "  {\"depth\": " << r.size[0] << ", \"rows\": " << r.size[1] << ", \"cols\": " << r.size[2]
+                << ", \"filter\": \"" << r.filter << "\", \"levels\": " << r.levels << ", \"stage\": \"" << r.stage << "\""
+                << ", \"repetitions\": " << r.repetitions << ", \"min\": " << r.min << ", \"median\": " << r.median
+                << ", \"p10\": " << r.p10 << ", \"p90\": " << r.p90 << ", \"mean\": " << r.mean
+                << ", \"mvoxels_per_second\": " << voxels / r.median / 1e6 << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "]" << endl;
+        return;
+    }
+
+    out << "depth,rows,cols,filter,levels,stage,repetitions,min,median,p10,p90,mean,mvoxels_per_second\n";
+    for (const BenchResult& r : results) {
+        double voxels = static_cast<double>(r.size[0]) * r.size[1] * r.size[2];
+        out << r.size[0] << "," << r.size[1] << "," << r.size[2] << "," << r.filter << "," << r.levels << "," << r.stage << ","
+            << r.repetitions << "," << r.min << "," << r.median << "," << r.p10 << "," << r.p90 << "," << r.mean << ","
+            << voxels / r.median / 1e6 << "\n";
+    }
+    out.flush();
+}
+
+// Run every combination of size, filter, levels and stage
+static vector<BenchResult> run_benchmarks(const BenchOptions& options) {
+    vector<BenchResult> results;
+    auto wants = [&](const string& stage) { return find(options.stages.begin(), options.stages.end(), stage) != options.stages.end(); };
+
+    for (const array<size_t, 3>& size : options.sizes) {
+        Array3D<float> volume = synthetic_volume(size[0], size[1], size[2]);
+
+        // The IO stage does not depend on the filter: write the raw volume and read it back
+        if (wants("io")) {
+            filesystem::path dir = filesystem::temp_directory_path();
+            string data_file = (dir / "dwt_bench.bin").string();
+            string shape_file = (dir / "dwt_bench_shape.txt").string();
+            ofstream(shape_file) << size[0] << "," << size[1] << "," << size[2];
+
+            vector<double> times = time_runs([&]() {
+                if (!IO::export_inverse(volume, data_file)) {
+                    throw runtime_error("Error writing benchmark file: " + data_file);
+                }
+                Array3D<float> loaded = IO::read(data_file, shape_file);
+            }, options);
+            results.push_back(summarise(size, "-", 0, "io", times));
+
+            filesystem::remove(data_file);
+            filesystem::remove(shape_file);
+        }
+
+        for (const string& filter_type : options.filters) {
+            const FilterInfo* filter = find_filter(filter_type);
+            if (!filter) {
+                throw invalid_argument("Unknown filter: " + filter_type);
+            }
+            DWT dwt(filter->lpf, filter->hpf, filter->size);
+            Inverse inverse(filter->Ilpf, filter->Ihpf, filter->size);
+            DWTWorkspace workspace(size[0], size[1], size[2], filter->size);
+            Array3D<float> coefficients, reconstructed;
+
+            for (int levels : options.levels) {
+                cerr << size[0] << "x" << size[1] << "x" << size[2] << " " << filter_type << " levels " << levels << endl;
+
+                // The forward transform also provides the input of the inverse (run once, untimed, if not measured)
+                if (wants("forward")) {
+                    vector<double> times = time_runs([&]() { dwt.dwt_3d(volume, coefficients, levels, workspace); }, options);
+                    results.push_back(summarise(size, filter_type, levels, "forward", times));
+                } else {
+                    dwt.dwt_3d(volume, coefficients, levels, workspace);
+                }
+                if (wants("inverse")) {
+                    vector<double> times = time_runs([&]() { inverse.inverse_dwt_3d(coefficients, reconstructed, levels, workspace); }, options);
+                    results.push_back(summarise(size, filter_type, levels, "inverse", times));
+                }
+            }
+        }
+    }
+    return results;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        BenchOptions options;
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            size_t eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == string::npos) {
+                throw invalid_argument("Usage: " + string(argv[0]) + " [--sizes=DxRxC,...] [--filters=db1,...] [--levels=1,2,...]"
+                                       " [--stages=forward,inverse,io] [--warmup=N] [--repetitions=N] [--format=csv|json] [--output=<file>]");
+            }
+            string name = arg.substr(2, eq - 2);
+            string value = arg.substr(eq + 1);
+
+            if (name == "sizes") {
+                options.sizes.clear();
+                for (const string& size : split(value)) {
+                    options.sizes.push_back(parse_size(size));
+                }
+            } else if (name == "filters") {
+                options.filters = split(value);
+            } else if (name == "levels") {
+                options.levels.clear();
+                for (const string& level : split(value)) {
+                    options.levels.push_back(parse_count(name, level, 1));
+                }
+            } else if (name == "stages") {
+                options.stages = split(value);
+                for (const string& stage : options.stages) {
+                    if (stage != "forward" && stage != "inverse" && stage != "io") {
+                        throw invalid_argument("Unknown stage (use forward, inverse or io): " + stage);
+                    }
+                }
+            } else if (name == "warmup") {
+                options.warmup = parse_count(name, value, 0);
+            } else if (name == "repetitions") {
+                options.repetitions = parse_count(name, value, 1);
+            } else if (name == "format") {
+                if (value != "csv" && value != "json") {
+                    throw invalid_argument("Unknown format (use csv or json): " + value);
+                }
+                options.format = value;
+            } else if (name == "output") {
+                options.output = value;
+            } else {
+                throw invalid_argument("Unknown option: " + arg);
+            }
+        }
+
+        cerr << "Benchmarking with " << thread_count() << " threads, instruction set " << isa_name(active_isa()) << endl;
+        vector<BenchResult> results = run_benchmarks(options);
+
+        if (options.output.empty()) {
+            write_results(cout, results, options.format);
+        } else {
+            ofstream file(options.output);
+            if (!file) {
+                throw runtime_error("Error opening file for writing: " + options.output);
+            }
+            write_results(file, results, options.format);
+            cerr << "Results written to " << options.output << endl;
+        }
+    } catch (const invalid_argument& e) {
+        cerr << "Invalid argument: " << e.what() << endl;
+        return 1;
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
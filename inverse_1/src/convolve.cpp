@@ -2,7 +2,7 @@
 
 // Constructor for the Convolve class
 Convolve::Convolve(const float* lpf, const float* hpf, size_t filter_size)
-    : lpf(lpf), hpf(hpf), filter_size(filter_size) {}
+    : lpf(lpf), hpf(hpf), filter_size(filter_size), kernels{analysis_kernel(filter_size), analysis_kernel(filter_size, true)} {}
 
 /* 
  * Convolution along the first dimension (rows)
@@ -14,32 +14,12 @@ Convolve::Convolve(const float* lpf, const float* hpf, size_t filter_size)
  */
 
 void Convolve::dim0(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const {
-    // Create a temporary copy to avoid overwriting the original data
-    Array3D<float> temp(data);
-
-    // Iterate over each slice in the depth dimension
-    for (size_t d = 0; d < depth_limit; ++d) {
-        // Iterate over each column in the current slice
-        for (size_t c = 0; c < col_limit; ++c) {
-            // Perform convolution for each row
-            for (size_t i = 0; i < row_limit / 2; ++i) {
-                float sum_low = 0.0f;  // Sum for low-pass filter
-                float sum_high = 0.0f; // Sum for high-pass filter
-
-                // Apply the filters
-                for (size_t j = 0; j < filter_size; ++j) {
-                    size_t index = (2 * i + j) % row_limit;
-                    float input_val = (index < row_limit) ? temp(d, index, c) : 0.0f; // Zero padding
-                    sum_low += lpf[j] * input_val;
-                    sum_high += hpf[j] * input_val;
-                }
-
-                // Store the results in the original data array
-                data(d, i, c) = sum_low;
-                data(d, i + row_limit / 2, c) = sum_high;
-            }
-        }
-    }
+    dim0(data.view(0, 0, 0, depth_limit, row_limit, col_limit));
+}
+
+// Convolution along the first dimension (rows) over the whole of a sub-volume view
+void Convolve::dim0(Array3DView<float> data, DWTWorkspace* workspace) const {
+    convolve(data, 0, workspace);
 }
 
 /* 
@@ -52,32 +32,12 @@ void Convolve::dim0(Array3D<float>& data, size_t depth_limit, size_t row_limit,
  */
 
 void Convolve::dim1(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const {
-    // Create a temporary copy to avoid overwriting the original data
-    Array3D<float> temp(data);
-
-    // Iterate over each slice in the depth dimension
-    for (size_t d = 0; d < depth_limit; ++d) {
-        // Iterate over each row in the current slice
-        for (size_t r = 0; r < row_limit; ++r) {
-            // Perform convolution for each column
-            for (size_t i = 0; i < col_limit / 2; ++i) {
-                float sum_low = 0.0f;  // Sum for low-pass filter
-                float sum_high = 0.0f; // Sum for high-pass filter
-
-                // Apply the filters
-                for (size_t j = 0; j < filter_size; ++j) {
-                    size_t index = (2 * i + j) % col_limit;
-                    float input_val = (index < col_limit) ? temp(d, r, index) : 0.0f; // Zero padding
-                    sum_low += lpf[j] * input_val;
-                    sum_high += hpf[j] * input_val;
-                }
-
-                // Store the results in the original data array
-                data(d, r, i) = sum_low;
-                data(d, r, i + col_limit / 2) = sum_high;
-            }
-        }
-    }
+    dim1(data.view(0, 0, 0, depth_limit, row_limit, col_limit));
+}
+
+// Convolution along the second dimension (columns) over the whole of a sub-volume view
+void Convolve::dim1(Array3DView<float> data, DWTWorkspace* workspace) const {
+    convolve(data, 1, workspace);
 }
 
 /* 
@@ -90,30 +50,88 @@ void Convolve::dim1(Array3D<float>& data, size_t depth_limit, size_t row_limit,
  */
 
 void Convolve::dim2(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const {
-    // Create a temporary copy to avoid overwriting the original data
-    Array3D<float> temp(data);
-
-    // Iterate over each row in the current slice
-    for (size_t r = 0; r < row_limit; ++r) {
-        // Iterate over each column in the current row
-        for (size_t c = 0; c < col_limit; ++c) {
-            // Perform convolution for each depth
-            for (size_t i = 0; i < depth_limit / 2; ++i) {
-                float sum_low = 0.0f;  // Sum for low-pass filter
-                float sum_high = 0.0f; // Sum for high-pass filter
-
-                // Apply the filters
-                for (size_t j = 0; j < filter_size; ++j) {
-                    size_t index = (2 * i + j) % depth_limit;
-                    float input_val = (index < depth_limit) ? temp(index, r, c) : 0.0f; // Zero padding
-                    sum_low += lpf[j] * input_val;
-                    sum_high += hpf[j] * input_val;
-                }
-
-                // Store the results in the original data array
-                data(i, r, c) = sum_low;
-                data(i + depth_limit / 2, r, c) = sum_high;
-            }
-        }
+    dim2(data.view(0, 0, 0, depth_limit, row_limit, col_limit));
+}
+
+// Convolution along the third dimension (depths) over the whole of a sub-volume view
+void Convolve::dim2(Array3DView<float> data, DWTWorkspace* workspace) const {
+    convolve(data, 2, workspace);
+}
+/* 
+ * Convolve and subsample one contiguous line
+ * Parameters:
+ * - in: the input line
+ * - n: number of elements in the line
+ * - out: output line; the low-pass half is stored first, followed by the high-pass half
+ */
+void Convolve::analyze_line(const float* in, size_t n, float* out) const {
+    // An odd last element is left untouched, as in the in-place dimension passes
+    if (n % 2 != 0) {
+        out[n - 1] = in[n - 1];
+    }
+
+    kernels.contiguous(in, 1, out, 1, n, lpf, hpf, filter_size);
+}
+
+/* 
+ * Convolution along one dimension of a view
+ * The limits and strides of the lines come from the view, so one loop serves every
+ * axis, with the kernel specialised for unit-stride lines where the axis allows.
+ * Parameters:
+ * - data: view of the data to be convolved in place
+ * - dimension: 0 = rows, 1 = columns, 2 = depth
+ * - workspace: scratch memory and threads, or nullptr to allocate them
+ */
+void Convolve::convolve(Array3DView<float> data, int dimension, DWTWorkspace* workspace) const {
+    transform_axis(data, dimension, kernels, lpf, hpf, filter_size, workspace);
+}
+
+// Convolution along one dimension of a view on the calling thread, through a scratch buffer of the caller's
+void Convolve::dim_serial(Array3DView<float> data, int axis, float* scratch) const {
+    transform_axis_serial(data, axis, kernels, lpf, hpf, filter_size, scratch);
+}
+
+/* 
+ * Convolution along an axis of a tiled array
+ * Each line is gathered into a contiguous buffer, transformed and scattered back,
+ * so every axis is streamed with the same tile locality.
+ * Parameters:
+ * - data: tiled 3D array of data to be convolved
+ * - axis: 0 = rows, 1 = columns, 2 = depth (as dim0, dim1 and dim2)
+ * - depth_limit: number of slices in the depth dimension
+ * - row_limit: number of rows in each slice
+ * - col_limit: number of columns in each slice
+ */
+void Convolve::dim(TiledArray3D<float>& data, int axis, size_t depth_limit, size_t row_limit, size_t col_limit, DWTWorkspace* workspace) const {
+    PROFILE_SCOPE(axis == 0 ? "dim0" : (axis == 1 ? "dim1" : "dim2"), -1, axis);
+    size_t n = axis == 0 ? row_limit : (axis == 1 ? col_limit : depth_limit);
+
+    // Each element is loaded and stored once; the line buffers stay in cache
+    size_t elements = depth_limit * row_limit * col_limit;
+    Profiler::add_work(2.0 * sizeof(float) * elements, kernel_flops(elements / max<size_t>(n, 1), n, filter_size));
+
+    vector<vector<float>> local_lines;
+    if (!workspace) {
+        local_lines.assign(thread_count(), vector<float>(2 * n));
     }
-}
\ No newline at end of file
+
+    // Iterate over the two other axes, keeping the columns innermost where possible
+    size_t outer = axis == 2 ? row_limit : depth_limit;
+    size_t inner = axis == 1 ? row_limit : col_limit;
+
+    parallel_for(workspace, 0, outer, [&](size_t a, size_t t) {
+        // Each thread uses its own input and output line buffers
+        float* in = workspace ? workspace->line(t) : local_lines[t].data();
+        float* out = in + n;
+
+        for (size_t b = 0; b < inner; ++b) {
+            size_t d = axis == 2 ? 0 : a;
+            size_t r = axis == 0 ? 0 : (axis == 1 ? b : a);
+            size_t c = axis == 1 ? 0 : b;
+
+            data.load_line(axis, d, r, c, n, in);
+            analyze_line(in, n, out);
+            data.store_line(axis, d, r, c, n, out);
+        }
+    });
+}
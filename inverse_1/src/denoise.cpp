@@ -0,0 +1,89 @@
+#include "denoise.h"
+#include "DWT.h"
+#include <cmath>
+
+/*
+ * Estimate the universal threshold of a transformed volume
+ * The finest diagonal band (HHH of level 1) holds mostly noise, so its median absolute
+ * deviation gives a robust estimate of the noise level: sigma = MAD / 0.6745.
+ * Parameters:
+ * - coefficients: the transformed volume (at least one level)
+ * Returns:
+ * - sigma * sqrt(2 ln N), N being the number of voxels
+ */
+float Denoise::universal_threshold(Array3DView<const float> coefficients) {
+    size_t sub_depth = coefficients.get_depth() / 2;
+    size_t sub_rows = coefficients.get_rows() / 2;
+    size_t sub_cols = coefficients.get_cols() / 2;
+
+    vector<float> magnitudes;
+    magnitudes.reserve(sub_depth * sub_rows * sub_cols);
+    for (size_t d = 0; d < sub_depth; ++d) {
+        for (size_t r = 0; r < sub_rows; ++r) {
+            for (size_t c = 0; c < sub_cols; ++c) {
+                magnitudes.push_back(fabs(coefficients(sub_depth + d, sub_rows + r, sub_cols + c)));
+            }
+        }
+    }
+    if (magnitudes.empty()) {
+        return 0.0f;
+    }
+
+    auto middle = magnitudes.begin() + magnitudes.size() / 2;
+    nth_element(magnitudes.begin(), middle, magnitudes.end());
+    double sigma = *middle / 0.6745;
+    return static_cast<float>(sigma * sqrt(2.0 * log(static_cast<double>(coefficients.size()))));
+}
+
+/*
+ * Soft-threshold the detail coefficients of a transformed volume
+ * Coefficients inside the LLL band of the deepest level are kept; every other one
+ * is shrunk towards zero by the threshold, and set to zero if it is smaller.
+ * Parameters:
+ * - coefficients: the transformed volume
+ * - levels: number of levels of decomposition used for the transform
+ * - threshold: the amount to shrink by
+ * - workspace: threads to use (new threads if null)
+ */
+void Denoise::soft_threshold(Array3DView<float> coefficients, int levels, float threshold, DWTWorkspace* workspace) {
+    PROFILE_SCOPE("soft_threshold");
+
+    // The LLL band of the deepest level, laid out as in IO::export_subbands
+    size_t depth = coefficients.get_depth(), rows = coefficients.get_rows(), cols = coefficients.get_cols();
+    size_t lll_depth = depth, lll_rows = rows, lll_cols = cols;
+    for (int level = 1; level < levels; ++level) {
+        lll_depth = (lll_depth + 1) / 2;
+        lll_rows = (lll_rows + 1) / 2;
+        lll_cols = (lll_cols + 1) / 2;
+    }
+    lll_depth /= 2;
+    lll_rows /= 2;
+    lll_cols /= 2;
+
+    parallel_for(workspace, 0, depth, [&](size_t d, size_t) {
+        for (size_t r = 0; r < rows; ++r) {
+            // Only the columns past the LLL band are details in rows that cross it
+            size_t c0 = d < lll_depth && r < lll_rows ? lll_cols : 0;
+            float* line = coefficients.address(d, r, 0);
+            ptrdiff_t stride = coefficients.get_col_stride();
+            for (size_t c = c0; c < cols; ++c) {
+                float& value = line[c * stride];
+                float magnitude = fabs(value) - threshold;
+                value = magnitude > 0.0f ? copysign(magnitude, value) : 0.0f;
+            }
+        }
+    });
+}
+
+// Denoise a volume: forward transform, soft thresholding and inverse transform, all in the result
+float Denoise::run(const DWT& dwt, const Inverse& inverse, Array3DView<const float> data, Array3DView<float> result,
+                   int levels, float threshold, DWTWorkspace& workspace) {
+    PROFILE_SCOPE("denoise");
+    dwt.dwt_3d(data, result, levels, workspace);
+    if (threshold < 0.0f) {
+        threshold = universal_threshold(result);
+    }
+    soft_threshold(result, levels, threshold, &workspace);
+    inverse.inverse_dwt_3d(result, result, levels, workspace);
+    return threshold;
+}
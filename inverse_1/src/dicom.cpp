@@ -0,0 +1,348 @@
+#include "dicom.h"
+#include "utilities/convert.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+// Transfer syntaxes with uncompressed little endian pixel data
+const string IMPLICIT_LITTLE_ENDIAN = "1.2.840.10008.1.2";
+const string EXPLICIT_LITTLE_ENDIAN = "1.2.840.10008.1.2.1";
+
+const uint32_t UNDEFINED_LENGTH = 0xFFFFFFFF;
+
+// Sequential reader for the data elements of a DICOM file
+struct ElementReader {
+    ifstream& file;
+    const string& filename;
+    bool explicit_vr;
+
+    uint16_t read_u16() {
+        unsigned char b[2];
+        file.read(reinterpret_cast<char*>(b), 2);
+        return static_cast<uint16_t>(b[0] | (b[1] << 8));
+    }
+
+    uint32_t read_u32() {
+        unsigned char b[4];
+        file.read(reinterpret_cast<char*>(b), 4);
+        return static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) | (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+    }
+
+    // Read a US value, keeping the given one when the element is empty, and skip the rest of it
+    uint16_t read_us(uint32_t length, uint16_t empty) {
+        if (length < 2) {
+            file.seekg(length, ios::cur);
+            return empty;
+        }
+        uint16_t value = read_u16();
+        file.seekg(length - 2, ios::cur);
+        return value;
+    }
+
+    string read_string(uint32_t length) {
+        string value(length, '\0');
+        file.read(&value[0], length);
+        // Strip the padding used to keep values at an even length
+        while (!value.empty() && (value.back() == '\0' || value.back() == ' ')) {
+            value.pop_back();
+        }
+        return value;
+    }
+
+    // Read the next element header; returns false at the end of the file
+    bool next(uint16_t& group, uint16_t& element, uint32_t& length) {
+        group = read_u16();
+        if (!file) {
+            return false;
+        }
+        element = read_u16();
+
+        // Item and delimitation tags never carry a VR
+        if (group == 0xFFFE || !explicit_vr) {
+            length = read_u32();
+        } else {
+            char vr[2];
+            file.read(vr, 2);
+            static const char* long_vrs[] = {"OB", "OD", "OF", "OL", "OV", "OW", "SQ", "SV", "UC", "UN", "UR", "UT", "UV"};
+            bool long_length = false;
+            for (const char* long_vr : long_vrs) {
+                if (vr[0] == long_vr[0] && vr[1] == long_vr[1]) {
+                    long_length = true;
+                }
+            }
+            if (long_length) {
+                read_u16(); // reserved
+                length = read_u32();
+            } else {
+                length = read_u16();
+            }
+        }
+
+        if (!file) {
+            throw runtime_error("Truncated DICOM element in file: " + filename);
+        }
+        return true;
+    }
+
+    // Skip the contents of an undefined length sequence or item up to its delimiter
+    void skip_undefined() {
+        uint16_t group, element;
+        uint32_t length;
+        while (next(group, element, length)) {
+            if (group == 0xFFFE && (element == 0xE0DD || element == 0xE00D)) {
+                return;
+            }
+            if (length == UNDEFINED_LENGTH) {
+                skip_undefined();
+            } else {
+                file.seekg(length, ios::cur);
+            }
+        }
+        throw runtime_error("Unterminated DICOM sequence in file: " + filename);
+    }
+};
+
+// Parse a backslash separated list of decimal strings
+void parse_decimals(const string& value, double* out, size_t count) {
+    stringstream ss(value);
+    string item;
+    for (size_t i = 0; i < count && getline(ss, item, '\\'); ++i) {
+        out[i] = stod(item);
+    }
+}
+
+// Parse an integer string (IS) value, which may be padded with spaces and signed; 0 if empty
+long parse_integer(const string& value, const string& filename) {
+    size_t first = value.find_first_not_of(' ');
+    if (first == string::npos) {
+        return 0;
+    }
+    size_t last = value.find_last_not_of(' ');
+    string trimmed = value.substr(first, last - first + 1);
+    try {
+        size_t end = 0;
+        long result = stol(trimmed, &end);
+        if (end == trimmed.size()) {
+            return result;
+        }
+    } catch (const logic_error&) {
+    }
+    throw runtime_error("Invalid integer string '" + value + "' in file: " + filename);
+}
+
+// Convert a row of stored pixel values to float
+template <class S>
+void widen_row(const char* in, float* out, size_t cols) {
+    for (size_t c = 0; c < cols; ++c) {
+        S value;
+        memcpy(&value, in + c * sizeof(S), sizeof(S));
+        out[c] = static_cast<float>(value);
+    }
+}
+
+} // namespace
+
+/*
+ * Parse the header of a DICOM slice up to the start of its pixel data
+ * Parameters:
+ * - filename: the name of the .dcm file
+ * Returns:
+ * - The slice geometry, pixel format and the location of the pixel data
+ */
+DICOMSlice DICOM::read_header(const string& filename) {
+    ifstream file(filename, ios::binary);
+
+    // Check if the file was opened successfully
+    if (!file) {
+        throw runtime_error("Error opening DICOM file: " + filename);
+    }
+
+    DICOMSlice slice;
+    slice.filename = filename;
+
+    // Files with a preamble start with 128 bytes followed by "DICM"
+    char preamble[132];
+    file.read(preamble, sizeof(preamble));
+    bool has_meta = file && memcmp(preamble + 128, "DICM", 4) == 0;
+    file.clear();
+    file.seekg(has_meta ? 132 : 0);
+
+    // The file meta group is always explicit VR; the data set follows the transfer syntax
+    string transfer_syntax = IMPLICIT_LITTLE_ENDIAN;
+    bool in_meta = has_meta;
+    ElementReader reader{file, filename, has_meta};
+
+    uint16_t group, element;
+    uint32_t length;
+    while (true) {
+        streamoff position = file.tellg();
+        if (!reader.next(group, element, length)) {
+            break;
+        }
+
+        // Switch to the data set encoding when the meta group ends
+        if (in_meta && group != 0x0002) {
+            if (transfer_syntax != IMPLICIT_LITTLE_ENDIAN && transfer_syntax != EXPLICIT_LITTLE_ENDIAN) {
+                throw runtime_error("Unsupported (compressed or big endian) transfer syntax " + transfer_syntax + " in file: " + filename);
+            }
+            in_meta = false;
+            reader.explicit_vr = transfer_syntax == EXPLICIT_LITTLE_ENDIAN;
+            file.seekg(position);
+            continue;
+        }
+
+        uint32_t tag = (static_cast<uint32_t>(group) << 16) | element;
+
+        if (tag == 0x7FE00010) {
+            // Pixel data: record its location and stop parsing
+            if (length == UNDEFINED_LENGTH) {
+                throw runtime_error("Encapsulated (compressed) pixel data is not supported in file: " + filename);
+            }
+            slice.pixel_offset = file.tellg();
+            slice.pixel_length = length;
+            break;
+        }
+
+        if (length == UNDEFINED_LENGTH) {
+            reader.skip_undefined();
+            continue;
+        }
+
+        switch (tag) {
+        case 0x00020010: transfer_syntax = reader.read_string(length); break;
+        case 0x00280002: slice.samples_per_pixel = reader.read_us(length, slice.samples_per_pixel); break;
+        case 0x00280010: slice.rows = reader.read_us(length, slice.rows); break;
+        case 0x00280011: slice.cols = reader.read_us(length, slice.cols); break;
+        case 0x00280100: slice.bits_allocated = reader.read_us(length, slice.bits_allocated); break;
+        case 0x00280103: slice.pixel_representation = reader.read_us(length, slice.pixel_representation); break;
+        case 0x00200013: slice.instance_number = parse_integer(reader.read_string(length), filename); break;
+        case 0x00200032: parse_decimals(reader.read_string(length), slice.position, 3); slice.has_position = true; break;
+        case 0x00200037: parse_decimals(reader.read_string(length), slice.orientation, 6); break;
+        default: file.seekg(length, ios::cur); break;
+        }
+
+        if (!file) {
+            throw runtime_error("Error reading DICOM header from file: " + filename);
+        }
+    }
+
+    if (slice.pixel_offset < 0) {
+        throw runtime_error("No pixel data found in file: " + filename);
+    }
+    return slice;
+}
+
+/*
+ * Decode the pixel data of one slice into a depth slice of the volume
+ * Parameters:
+ * - slice: the parsed header of the slice
+ * - data: the volume to write to
+ * - depth: the index of the slice in the volume
+ * - buffer: scratch buffer for the raw pixel data (reused between slices)
+ */
+void DICOM::read_pixels(const DICOMSlice& slice, Array3D<float>& data, size_t depth, vector<char>& buffer) {
+    size_t bytes_per_pixel = slice.bits_allocated / 8;
+    size_t row_bytes = slice.cols * bytes_per_pixel;
+    size_t slice_bytes = slice.rows * row_bytes;
+
+    if (slice.pixel_length < slice_bytes) {
+        throw runtime_error("Pixel data is shorter than the image size in file: " + slice.filename);
+    }
+
+    ifstream file(slice.filename, ios::binary);
+    buffer.resize(slice_bytes);
+    file.seekg(slice.pixel_offset);
+    file.read(buffer.data(), slice_bytes);
+    if (!file) {
+        throw runtime_error("Error reading pixel data from file: " + slice.filename);
+    }
+
+    bool is_signed = slice.pixel_representation == 1;
+    for (size_t r = 0; r < slice.rows; ++r) {
+        const char* in = buffer.data() + r * row_bytes;
+        float* out = &data(depth, r, 0);
+        switch (slice.bits_allocated) {
+        case 8:  is_signed ? widen_row<int8_t>(in, out, slice.cols) : widen_row<uint8_t>(in, out, slice.cols); break;
+        case 16:
+            // The pixel data starts at an even offset, so the rows are suitably aligned for 16-bit access
+            if (is_signed) {
+                widen_int16(reinterpret_cast<const int16_t*>(in), out, slice.cols);
+            } else {
+                widen_uint16(reinterpret_cast<const uint16_t*>(in), out, slice.cols);
+            }
+            break;
+        case 32: is_signed ? widen_row<int32_t>(in, out, slice.cols) : widen_row<uint32_t>(in, out, slice.cols); break;
+        }
+    }
+}
+
+/*
+ * Read an uncompressed DICOM series into a 3D array
+ * Headers are parsed in parallel, the slices are sorted by their position along
+ * the slice normal (falling back to the instance number) and the pixel data is
+ * then decoded in parallel straight into the volume. Stored values are used as
+ * is (no rescale slope/intercept), matching python/create.py.
+ * Parameters:
+ * - directory: the directory containing the .dcm files of the series
+ * Returns:
+ * - A 3D array of float values with one depth slice per file
+ */
+Array3D<float> DICOM::read_series(const string& directory) {
+    PROFILE_SCOPE("read_series");
+    // Check if the directory exists
+    if (!filesystem::is_directory(directory)) {
+        throw runtime_error("DICOM directory does not exist: " + directory);
+    }
+
+    vector<string> filenames;
+    for (const auto& entry : filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".dcm") {
+            filenames.push_back(entry.path().string());
+        }
+    }
+    sort(filenames.begin(), filenames.end());
+
+    if (filenames.empty()) {
+        throw runtime_error("No .dcm files found in: " + directory);
+    }
+
+    // Parse the headers in parallel
+    vector<DICOMSlice> slices(filenames.size());
+    parallel_for(0, filenames.size(), [&](size_t i, size_t) {
+        slices[i] = read_header(filenames[i]);
+    });
+
+    // Check that all slices share the same format
+    const DICOMSlice& first = slices[0];
+    if (first.bits_allocated != 8 && first.bits_allocated != 16 && first.bits_allocated != 32) {
+        throw runtime_error("Unsupported bits allocated (" + to_string(first.bits_allocated) + ") in file: " + first.filename);
+    }
+    for (const auto& slice : slices) {
+        if (slice.rows != first.rows || slice.cols != first.cols || slice.bits_allocated != first.bits_allocated ||
+            slice.pixel_representation != first.pixel_representation || slice.samples_per_pixel != 1) {
+            throw runtime_error("Inconsistent or multi-sample slice in DICOM series: " + slice.filename);
+        }
+    }
+
+    // Sort the slices by their position along the normal of the image plane
+    const double* o = first.orientation;
+    double normal[3] = {o[1] * o[5] - o[2] * o[4], o[2] * o[3] - o[0] * o[5], o[0] * o[4] - o[1] * o[3]};
+    bool use_position = all_of(slices.begin(), slices.end(), [](const DICOMSlice& s) { return s.has_position; });
+
+    auto key = [&](const DICOMSlice& s) {
+        return use_position ? s.position[0] * normal[0] + s.position[1] * normal[1] + s.position[2] * normal[2] : static_cast<double>(s.instance_number);
+    };
+    stable_sort(slices.begin(), slices.end(), [&](const DICOMSlice& a, const DICOMSlice& b) { return key(a) < key(b); });
+
+    // Decode the slices in parallel, each thread reusing its own buffer
+    Array3D<float> data(slices.size(), first.rows, first.cols, uninitialised);
+    vector<vector<char>> buffers(thread_count());
+    parallel_for(0, slices.size(), [&](size_t d, size_t t) {
+        read_pixels(slices[d], data, d, buffers[t]);
+    }, buffers.size());
+
+    return data;
+}
@@ -1,104 +1,30 @@
 #include "filters.h"
 
-// Function to get the wavelet filters based on the filter type
-bool get_filters(const string& filter_type, const float*& lpf, const float*& hpf, const float*& Ilpf, const float*& Ihpf, size_t& filter_size) {
-    if (filter_type == "db1" || filter_type == "haar") {
-        lpf = DB1_L;
-        hpf = DB1_H;
-        Ilpf = DB1_L;
-        Ihpf = DB1_H;
-        filter_size = 2;
-    } else if (filter_type == "db2") {
-        lpf = DB2_L;
-        hpf = DB2_H;
-        Ilpf = DB2_I_L;
-        Ihpf = DB2_I_H;
-        filter_size = 4;
-    } else if (filter_type == "db3") {
-        lpf = DB3_L;
-        hpf = DB3_H;
-        Ilpf = DB3_I_L;
-        Ihpf = DB3_I_H;
-        filter_size = 6;
-    } else if (filter_type == "db4") {
-        lpf = DB4_L;
-        hpf = DB4_H;
-        Ilpf = DB4_I_L;
-        Ihpf = DB4_I_H;
-        filter_size = 8;
-    } else if (filter_type == "db5") {
-        lpf = DB5_L;
-        hpf = DB5_H;
-        filter_size = 10;
-    } else if (filter_type == "db6") {
-        lpf = DB6_L;
-        hpf = DB6_H;
-        filter_size = 12;
-    } else if (filter_type == "db7") {
-        lpf = DB7_L;
-        hpf = DB7_H;
-        filter_size = 14;
-    } else if (filter_type == "db8") {
-        lpf = DB8_L;
-        hpf = DB8_H;
-        Ilpf = DB8_I_L;
-        Ihpf = DB8_I_H;
-        filter_size = 16;
-    } else {
-        cerr << "Unsupported filter type!" << endl;
-        return false;
-    }
-    return true;
-}
+/*
+ * Filter coefficients
+ * Each wavelet is given by its low-pass filter(s) only; the high-pass and synthesis
+ * filters are derived at compile time by orthogonal() and biorthogonal().
+ */
 
 //------------------------db1-------------------------
 
-float DB1_L[2] = {
-    0.7071067811865476, 
+constexpr double DB1[2] = {
+    0.7071067811865476,
     0.7071067811865476
 };
 
-float DB1_H[2] = {
-    0.7071067811865476, 
-    -0.7071067811865476
-};
-
 //------------------------db2-------------------------
 
-float DB2_L[4] = {
+constexpr double DB2[4] = {
     0.48296291314469025,
     0.836516303737469,
     0.22414386804185735,
     -0.12940952255092145
 };
 
-float DB2_H[4] = {
-    -0.12940952255092145,
-    -0.22414386804185735,
-    0.836516303737469,
-    -0.48296291314469025
-};
-
-
-float DB2_I_L[4] = { 
-    0.48296291314453416,       
-    0.8365163037378079, 
-    0.2241438680420134,       
-    -0.12940952255126037 
-};
-
-
-float DB2_I_H[4] = {
-    -0.12940952255126037,      
-    -0.2241438680420134, 
-    0.8365163037378079,       
-    -0.48296291314453416 
-};
-
-
 //------------------------db3-------------------------
 
-float DB3_L[6] = {
+constexpr double DB3[6] = {
     0.3326705529509569,
     0.8068915093133388,
     0.4598775021193313,
@@ -107,36 +33,9 @@ float DB3_L[6] = {
     0.035226291882100656
 };
 
-float DB3_H[6] = {
-    0.035226291882100656,
-    0.08544127388224149,
-    -0.13501102001039084,
-    -0.4598775021193313,
-    0.8068915093133388,
-    -0.3326705529509569
-};
-
-float DB3_I_L[6] = {
-    0.3326705529509569,
-    0.8068915093133388,
-    0.4598775021193313,
-    -0.13501102001039084,
-    -0.08544127388224149,
-    0.035226291882100656
-};
-
-float DB3_I_H[6] = {
-    0.035226291882100656,
-    0.08544127388224149,
-    -0.13501102001039084,
-    -0.4598775021193313,
-    0.8068915093133388,
-    -0.3326705529509569
-};
-
 //------------------------db4-------------------------
 
-float DB4_L[8] = {
+constexpr double DB4[8] = {
     0.23037781330885523,
     0.7148465705525415,
     0.6308807679295904,
@@ -147,42 +46,9 @@ float DB4_L[8] = {
     -0.010597401784997278
 };
 
-float DB4_H[8] = {
-    -0.010597401784997278,
-    -0.032883011666982945,
-    0.030841381835986965,
-    0.18703481171888114,
-    -0.02798376941698385,
-    -0.6308807679295904,
-    0.7148465705525415,
-    -0.23037781330885523
-};
-
-float DB4_I_L[8] = {
-    0.23037781330885523  ,
-    0.7148465705525415   ,
-    0.6308807679295904   ,
-    -0.02798376941698385 ,
-    -0.18703481171888114 ,
-    0.030841381835986965 ,
-    0.032883011666982945 ,
-    -0.010597401784997278
-};
-
-float DB4_I_H[8] = {
-    -0.010597401784997278,
-    -0.032883011666982945,
-    0.030841381835986965 ,
-    0.18703481171888114  ,
-    -0.02798376941698385 ,
-    -0.6308807679295904  ,
-    0.7148465705525415   ,
-    -0.23037781330885523
-};
-
 //------------------------db5-------------------------
 
-float DB5_L[10] = {
+constexpr double DB5[10] = {
     0.160102397974125,
     0.6038292697974729,
     0.7243085284385744,
@@ -195,22 +61,9 @@ float DB5_L[10] = {
     0.003335725285001549
 };
 
-float DB5_H[10] = {
-    -0.160102397974125,
-    0.6038292697974729,
-    -0.7243085284385744,
-    0.13842814590110342,
-    0.24229488706619015,
-    -0.03224486958502952,
-    -0.07757149384006515,
-    -0.006241490213011705,
-    0.012580751999015526,
-    0.003335725285001549
-};
-
 //------------------------db6-------------------------
 
-float DB6_L[12] = {
+constexpr double DB6[12] = {
     0.11154074335008017,
     0.4946238903983854,
     0.7511339080215775,
@@ -225,24 +78,9 @@ float DB6_L[12] = {
     -0.00107730108499558
 };
 
-float DB6_H[12] = {
-    -0.11154074335008017,
-    0.4946238903983854,
-    -0.7511339080215775,
-    0.3152503517092432,
-    0.22626469396516913,
-    -0.12976686756709563,
-    -0.09750160558707936,
-    0.02752286553001629,
-    0.031582039318031156,
-    0.0005538422009938016,
-    -0.004777257511010651,
-    -0.00107730108499558
-};
-
 //------------------------db7-------------------------
 
-float DB7_L[14] = {
+constexpr double DB7[14] = {
     0.07785205408506236,
     0.39653931948230575,
     0.7291320908465551,
@@ -259,26 +97,9 @@ float DB7_L[14] = {
     0.0003537138000010399
 };
 
-float DB7_H[14] = {
-    -0.07785205408506236,
-    0.39653931948230575,
-    -0.7291320908465551,
-    0.4697822874053586,
-    0.14390600392910627,
-    -0.22403618499416572,
-    -0.07130921926705004,
-    0.0806126091510659,
-    0.03802993693503463,
-    -0.01657454163101562,
-    -0.012550998556013784,
-    0.00042957797300470274,
-    0.0018016407039998328,
-    0.0003537138000010399
-};
-
 //------------------------db8-------------------------
 
-float DB8_L[16] = {
+constexpr double DB8[16] = {
     0.05441584224308161,
     0.3128715909144659,
     0.6756307362980128,
@@ -297,59 +118,343 @@ float DB8_L[16] = {
     -0.00011747678400228192
 };
 
-float DB8_H[16] = {
-    -0.05441584224308161,
-    0.3128715909144659,
-    -0.6756307362980128,
-    0.5853546836548691,
-    0.015829105256023893,
-    -0.2840155429624281,
-    -0.00047248457399797254,
-    0.128747426620186,
-    0.01736930100202211,
-    -0.04408825393106472,
-    -0.013981027917015516,
-    0.008746094047015655,
-    0.00487035299301066,
-    -0.0003917403729959771,
-    -0.0006754494059985568,
-    -0.00011747678400228192
+//------------------------sym4------------------------
+
+constexpr double SYM4[8] = {
+    0.032223100604051466,
+    -0.012603967262031317,
+    -0.09921954357663355,
+    0.2978577956053061,
+    0.8037387518051319,
+    0.49761866763277507,
+    -0.0296355276460026,
+    -0.07576571478950224
 };
 
-float DB8_I_L[16] = {
-    0.05441584224308161,
-    0.3128715909144659,
-    0.6756307362980128,
-    0.5853546836548691,
-    -0.015829105256023893,
-    -0.2840155429624281,
-    0.00047248457399797254,
-    0.128747426620186,
-    -0.01736930100202211,
-    -0.04408825393106472,
-    0.013981027917015516,
-    0.008746094047015655,
-    -0.00487035299301066,
-    -0.0003917403729959771,
-    0.0006754494059985568,
-    -0.00011747678400228192,
+//------------------------sym5------------------------
+
+constexpr double SYM5[10] = {
+    0.019538882735249827,
+    -0.021101834024689056,
+    -0.1753280899080562,
+    0.016602105764510808,
+    0.6339789634567922,
+    0.7234076904040408,
+    0.19939753397685558,
+    -0.039134249302313864,
+    0.029519490925706295,
+    0.027333068344998778
 };
 
-float DB8_I_H[16] = {
-    -0.00011747678400228192,
-    -0.0006754494059985568,
-    -0.0003917403729959771,
-    0.00487035299301066,
-    0.008746094047015655,
-    -0.013981027917015516,
-    -0.04408825393106472,
-    0.01736930100202211,
-    0.128747426620186,
-    -0.00047248457399797254,
-    -0.2840155429624281,
-    0.015829105256023893,
-    0.5853546836548691,
-    -0.6756307362980128,
-    0.3128715909144659,
-    -0.05441584224308161,
-};
\ No newline at end of file
+//------------------------sym6------------------------
+
+constexpr double SYM6[12] = {
+    -0.0078007083250323786,
+    0.001767711864254015,
+    0.04472490177078139,
+    -0.021060292512370907,
+    -0.07263752278637611,
+    0.33792942172816537,
+    0.7876411410286513,
+    0.49105594192797364,
+    -0.04831174258569805,
+    -0.11799011114852002,
+    0.003490712084222162,
+    0.015404109327044823
+};
+
+//------------------------sym7------------------------
+
+constexpr double SYM7[14] = {
+    0.010268176708511255,
+    0.004010244871533663,
+    -0.10780823770381774,
+    -0.14004724044296152,
+    0.2886296317515146,
+    0.767764317003164,
+    0.5361019170917628,
+    0.017441255086855827,
+    -0.049552834937127255,
+    0.0678926935013727,
+    0.03051551316596357,
+    -0.01263630340325193,
+    -0.0010473848886829163,
+    0.002681814568257878
+};
+
+//------------------------sym8------------------------
+
+constexpr double SYM8[16] = {
+    0.001889950332767687,
+    -0.00030292051472413645,
+    -0.014952258337062195,
+    0.0038087520138945685,
+    0.049137179673730096,
+    -0.027219029917103364,
+    -0.051945838107881816,
+    0.364441894836179,
+    0.7771857516996278,
+    0.48135965125905367,
+    -0.06127335906781116,
+    -0.1432942383512726,
+    0.007607487324976613,
+    0.03169508781152598,
+    -0.0005421323318000144,
+    -0.0033824159510050023
+};
+
+//------------------------coif1-----------------------
+
+constexpr double COIF1[6] = {
+    -0.0727326195128539,
+    0.3378976624578092,
+    0.8525720202122554,
+    0.38486484686420286,
+    -0.0727326195128539,
+    -0.01565572813546454
+};
+
+//------------------------coif2-----------------------
+
+constexpr double COIF2[12] = {
+    0.016387336463522112,
+    -0.04146493678175915,
+    -0.06737255472196302,
+    0.3861100668211622,
+    0.8127236354455423,
+    0.41700518442169254,
+    -0.0764885990783064,
+    -0.0594344186464569,
+    0.023680171946334084,
+    0.0056114348193944995,
+    -0.0018232088707029932,
+    -0.0007205494453645122
+};
+
+//------------------------coif3-----------------------
+
+constexpr double COIF3[18] = {
+    -0.003793512864491014,
+    0.007782596427325418,
+    0.023452696141836267,
+    -0.0657719112818555,
+    -0.06112339000267287,
+    0.4051769024096169,
+    0.7937772226256206,
+    0.42848347637761874,
+    -0.07179982161931202,
+    -0.08230192710688598,
+    0.03455502757306163,
+    0.015880544863615904,
+    -0.00900797613666158,
+    -0.0025745176887502236,
+    0.0011175187708906016,
+    0.0004662169601128863,
+    -7.098330313814125e-05,
+    -3.459977283621256e-05
+};
+
+//------------------------bior1.3----------------------
+
+constexpr double BIOR1_3_DEC[6] = {
+    -0.08838834764831845,
+    0.08838834764831845,
+    0.7071067811865476,
+    0.7071067811865476,
+    0.08838834764831845,
+    -0.08838834764831845
+};
+
+constexpr double BIOR1_3_REC[6] = {
+    0.0,
+    0.0,
+    0.7071067811865476,
+    0.7071067811865476,
+    0.0,
+    0.0
+};
+
+//------------------------bior2.2----------------------
+
+constexpr double BIOR2_2_DEC[6] = {
+    0.0,
+    -0.1767766952966369,
+    0.3535533905932738,
+    1.0606601717798212,
+    0.3535533905932738,
+    -0.1767766952966369
+};
+
+constexpr double BIOR2_2_REC[6] = {
+    0.0,
+    0.3535533905932738,
+    0.7071067811865476,
+    0.3535533905932738,
+    0.0,
+    0.0
+};
+
+//------------------------bior2.4----------------------
+
+constexpr double BIOR2_4_DEC[10] = {
+    0.0,
+    0.03314563036811942,
+    -0.06629126073623884,
+    -0.1767766952966369,
+    0.4198446513295126,
+    0.9943689110435825,
+    0.4198446513295126,
+    -0.1767766952966369,
+    -0.06629126073623884,
+    0.03314563036811942
+};
+
+constexpr double BIOR2_4_REC[10] = {
+    0.0,
+    0.0,
+    0.0,
+    0.3535533905932738,
+    0.7071067811865476,
+    0.3535533905932738,
+    0.0,
+    0.0,
+    0.0,
+    0.0
+};
+
+//------------------------bior3.1----------------------
+
+constexpr double BIOR3_1_DEC[4] = {
+    -0.3535533905932738,
+    1.0606601717798212,
+    1.0606601717798212,
+    -0.3535533905932738
+};
+
+constexpr double BIOR3_1_REC[4] = {
+    0.1767766952966369,
+    0.5303300858899106,
+    0.5303300858899106,
+    0.1767766952966369
+};
+
+//------------------------bior4.4----------------------
+
+constexpr double BIOR4_4_DEC[10] = {
+    0.0,
+    0.03782845550726404,
+    -0.023849465019556843,
+    -0.11062440441843718,
+    0.37740285561283066,
+    0.8526986790088938,
+    0.37740285561283066,
+    -0.11062440441843718,
+    -0.023849465019556843,
+    0.03782845550726404
+};
+
+constexpr double BIOR4_4_REC[10] = {
+    0.0,
+    -0.06453888262869706,
+    -0.04068941760916406,
+    0.41809227322161724,
+    0.7884856164055829,
+    0.41809227322161724,
+    -0.04068941760916406,
+    -0.06453888262869706,
+    0.0,
+    0.0
+};
+
+//------------------------banks-------------------------
+
+constexpr FilterBank<2> DB1_BANK = orthogonal(DB1);
+constexpr FilterBank<4> DB2_BANK = orthogonal(DB2);
+constexpr FilterBank<6> DB3_BANK = orthogonal(DB3);
+constexpr FilterBank<8> DB4_BANK = orthogonal(DB4);
+constexpr FilterBank<10> DB5_BANK = orthogonal(DB5);
+constexpr FilterBank<12> DB6_BANK = orthogonal(DB6);
+constexpr FilterBank<14> DB7_BANK = orthogonal(DB7);
+constexpr FilterBank<16> DB8_BANK = orthogonal(DB8);
+
+constexpr FilterBank<8> SYM4_BANK = orthogonal(SYM4);
+constexpr FilterBank<10> SYM5_BANK = orthogonal(SYM5);
+constexpr FilterBank<12> SYM6_BANK = orthogonal(SYM6);
+constexpr FilterBank<14> SYM7_BANK = orthogonal(SYM7);
+constexpr FilterBank<16> SYM8_BANK = orthogonal(SYM8);
+
+constexpr FilterBank<6> COIF1_BANK = orthogonal(COIF1);
+constexpr FilterBank<12> COIF2_BANK = orthogonal(COIF2);
+constexpr FilterBank<18> COIF3_BANK = orthogonal(COIF3);
+
+constexpr FilterBank<6> BIOR1_3_BANK = biorthogonal(BIOR1_3_DEC, BIOR1_3_REC);
+constexpr FilterBank<6> BIOR2_2_BANK = biorthogonal(BIOR2_2_DEC, BIOR2_2_REC);
+constexpr FilterBank<10> BIOR2_4_BANK = biorthogonal(BIOR2_4_DEC, BIOR2_4_REC);
+constexpr FilterBank<4> BIOR3_1_BANK = biorthogonal(BIOR3_1_DEC, BIOR3_1_REC);
+constexpr FilterBank<10> BIOR4_4_BANK = biorthogonal(BIOR4_4_DEC, BIOR4_4_REC);
+
+// Registry of the supported wavelets (sym2 and sym3 are the same as db2 and db3)
+constexpr FilterInfo FILTERS[] = {
+    filter_entry("haar", DB1_BANK),
+    filter_entry("db1", DB1_BANK),
+    filter_entry("db2", DB2_BANK),
+    filter_entry("db3", DB3_BANK),
+    filter_entry("db4", DB4_BANK),
+    filter_entry("db5", DB5_BANK),
+    filter_entry("db6", DB6_BANK),
+    filter_entry("db7", DB7_BANK),
+    filter_entry("db8", DB8_BANK),
+    filter_entry("sym2", DB2_BANK),
+    filter_entry("sym3", DB3_BANK),
+    filter_entry("sym4", SYM4_BANK),
+    filter_entry("sym5", SYM5_BANK),
+    filter_entry("sym6", SYM6_BANK),
+    filter_entry("sym7", SYM7_BANK),
+    filter_entry("sym8", SYM8_BANK),
+    filter_entry("coif1", COIF1_BANK),
+    filter_entry("coif2", COIF2_BANK),
+    filter_entry("coif3", COIF3_BANK),
+    filter_entry("bior1.3", BIOR1_3_BANK),
+    filter_entry("bior2.2", BIOR2_2_BANK),
+    filter_entry("bior2.4", BIOR2_4_BANK),
+    filter_entry("bior3.1", BIOR3_1_BANK),
+    filter_entry("bior4.4", BIOR4_4_BANK),
+};
+
+// Look up a wavelet in the registry
+const FilterInfo* find_filter(const string& filter_type) {
+    for (const FilterInfo& filter : FILTERS) {
+        if (filter_type == filter.name) {
+            return &filter;
+        }
+    }
+    return nullptr;
+}
+
+// Get the names of all the wavelets in the registry
+vector<string> filter_names() {
+    vector<string> names;
+    for (const FilterInfo& filter : FILTERS) {
+        names.push_back(filter.name);
+    }
+    return names;
+}
+
+// Function to get the wavelet filters based on the filter type
+bool get_filters(const string& filter_type, const float*& lpf, const float*& hpf, const float*& Ilpf, const float*& Ihpf, size_t& filter_size) {
+    const FilterInfo* filter = find_filter(filter_type);
+    if (!filter) {
+        cerr << "Unsupported filter type! Available filters:";
+        for (const string& name : filter_names()) {
+            cerr << " " << name;
+        }
+        cerr << endl;
+        return false;
+    }
+    lpf = filter->lpf;
+    hpf = filter->hpf;
+    Ilpf = filter->Ilpf;
+    Ihpf = filter->Ihpf;
+    filter_size = filter->size;
+    return true;
+}
@@ -2,115 +2,225 @@
 #include <algorithm> // For std::min and std::max
 
 Inverse::Inverse(const float* lpf, const float* hpf, size_t filter_size)
-    : lpf(lpf), hpf(hpf), filter_size(filter_size) {}
+    : lpf(lpf), hpf(hpf), filter_size(filter_size), kernels{synthesis_kernel(filter_size), synthesis_kernel(filter_size, true)} {}
 
 void Inverse::dim0(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const {
-    Array3D<float> temp(data);
+    dim0(data.view(0, 0, 0, depth_limit, row_limit, col_limit));
+}
 
-    for (size_t d = 0; d < depth_limit; ++d) {
-        for (size_t c = 0; c < col_limit; ++c) {
-            for (size_t i = 0; i < row_limit; ++i) {
-                data(d, i, c) = 0.0f; // Initialize the data array to zero
-            }
-            for (size_t i = 0; i < row_limit / 2; ++i) {
-                float low_val = temp(d, i, c);
-                float high_val = temp(d, i + row_limit / 2, c);
-
-                for (size_t j = 0; j < filter_size; ++j) {
-                    size_t index = 2 * i + j;
-                    if (index < row_limit) {
-                        data(d, index, c) += (lpf[j] * low_val) + (hpf[j] * high_val);
-                    } else {
-                        data(d, index, c) += 0.0f; // Zero padding
-                    }
-                }
-            }
-        }
-    }
+void Inverse::dim0(Array3DView<float> data, DWTWorkspace* workspace) const {
+    convolve(data, 0, workspace);
 }
 
 void Inverse::dim1(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const {
-    Array3D<float> temp(data);
+    dim1(data.view(0, 0, 0, depth_limit, row_limit, col_limit));
+}
 
-    for (size_t d = 0; d < depth_limit; ++d) {
-        for (size_t r = 0; r < row_limit; ++r) {
-            for (size_t i = 0; i < col_limit; ++i) {
-                data(d, r, i) = 0.0f; // Initialize the data array to zero
-            }
-            for (size_t i = 0; i < col_limit / 2; ++i) {
-                float low_val = temp(d, r, i);
-                float high_val = temp(d, r, i + col_limit / 2);
-
-                for (size_t j = 0; j < filter_size; ++j) {
-                    size_t index = 2 * i + j;
-                    if (index < col_limit) {
-                        data(d, r, index) += (lpf[j] * low_val) + (hpf[j] * high_val);
-                    } else {
-                        data(d, r, index) += 0.0f; // Zero padding
-                    }
-                }
-            }
-        }
-    }
+void Inverse::dim1(Array3DView<float> data, DWTWorkspace* workspace) const {
+    convolve(data, 1, workspace);
 }
 
 void Inverse::dim2(Array3D<float>& data, size_t depth_limit, size_t row_limit, size_t col_limit) const {
-    Array3D<float> temp(data);
+    dim2(data.view(0, 0, 0, depth_limit, row_limit, col_limit));
+}
 
-    for (size_t r = 0; r < row_limit; ++r) {
-        for (size_t c = 0; c < col_limit; ++c) {
-            for (size_t i = 0; i < depth_limit; ++i) {
-                data(i, r, c) = 0.0f; // Initialize the data array to zero
-            }
-            for (size_t i = 0; i < depth_limit / 2; ++i) {
-                float low_val = temp(i, r, c);
-                float high_val = temp(i + depth_limit / 2, r, c);
-
-                for (size_t j = 0; j < filter_size; ++j) {
-                    size_t index = 2 * i + j;
-                    if (index < depth_limit) {
-                        data(index, r, c) += (lpf[j] * low_val) + (hpf[j] * high_val);
-                    } else {
-                        data(index, r, c) += 0.0f; // Zero padding
-                    }
-                }
-            }
-        }
-    }
+void Inverse::dim2(Array3DView<float> data, DWTWorkspace* workspace) const {
+    convolve(data, 2, workspace);
 }
 
-Array3D<float> Inverse::inverse_dwt_3d(const Array3D<float>& data, int levels) const {
+Array3D<float> Inverse::inverse_dwt_3d(const Array3D<float>& data, const AxisLevels& levels) const {
+    // Create the result and a workspace sized for this volume
+    Array3D<float> result;
+    DWTWorkspace workspace(data.get_depth(), data.get_rows(), data.get_cols(), filter_size);
+
+    inverse_dwt_3d(data, result, levels, workspace);
+
+    // Return the reconstructed data
+    return result;
+}
+
+void Inverse::inverse_dwt_3d(const Array3D<float>& data, Array3D<float>& result, const AxisLevels& levels, DWTWorkspace& workspace) const {
+    result.resize(data.get_depth(), data.get_rows(), data.get_cols(), uninitialised);
+    inverse_dwt_3d(data.view(), result.view(), levels, workspace);
+}
+
+// Perform the inverse transform into a view of caller-owned memory (in place if both views are the same)
+void Inverse::inverse_dwt_3d(Array3DView<const float> data, Array3DView<float> result, const AxisLevels& levels, DWTWorkspace& workspace) const {
     // Get the initial dimensions of the data
     size_t depth = data.get_depth();
     size_t rows = data.get_rows();
     size_t cols = data.get_cols();
 
-    // Create a copy of the input data to store the result
-    Array3D<float> result = data;
+    // Copy the input data into the result, which is reconstructed in place
+    if (!same_layout(data, result)) {
+        copy_view(data, result);
+    }
+    workspace.reserve(depth, rows, cols);
 
-    // Adjust the dimensions for the number of levels
-    vector<size_t> depth_levels(levels);
-    vector<size_t> row_levels(levels);
-    std::vector<size_t> col_levels(levels);
+    // Adjust the dimensions for the number of levels (the workspace keeps the capacity)
+    vector<size_t>& depth_levels = workspace.depth_levels;
+    vector<size_t>& row_levels = workspace.row_levels;
+    vector<size_t>& col_levels = workspace.col_levels;
+    level_bounds(depth, rows, cols, levels, depth_levels, row_levels, col_levels);
 
-    depth_levels[0] = depth;
-    row_levels[0] = rows;
-    col_levels[0] = cols;
+    for (int level = levels.max() - 1; level >= 0; --level) {
+        PROFILE_SCOPE("level", level + 1);
 
-    for (int i = 1; i < levels; ++i) {
-        depth_levels[i] = (depth_levels[i-1] + 1) / 2;
-        row_levels[i] = (row_levels[i-1] + 1) / 2;
-        col_levels[i] = (col_levels[i-1] + 1) / 2;
+        // Perform inverse convolution along each dimension
+        Array3DView<float> bounds = result.subview(0, 0, 0, depth_levels[level], row_levels[level], col_levels[level]);
+        inverse_level(bounds, levels, level, &workspace);
     }
+}
 
-    for (int level = levels - 1; level >= 0; --level) {
+void Inverse::synthesize_line(const float* in, size_t n, float* out) const {
+    kernels.contiguous(in, 1, out, 1, n, lpf, hpf, filter_size);
+}
 
-        // Perform inverse convolution along each dimension
-        dim2(result, depth_levels[level], row_levels[level], col_levels[level]);
-        dim1(result, depth_levels[level], row_levels[level], col_levels[level]);
-        dim0(result, depth_levels[level], row_levels[level], col_levels[level]);
+// Inverse transform along one dimension of a view, shared by dim0, dim1 and dim2
+void Inverse::convolve(Array3DView<float> data, int dimension, DWTWorkspace* workspace) const {
+    transform_axis(data, dimension, kernels, lpf, hpf, filter_size, workspace);
+}
+
+// Inverse transform along one dimension of a view on the calling thread
+void Inverse::dim_serial(Array3DView<float> data, int axis, float* scratch) const {
+    transform_axis_serial(data, axis, kernels, lpf, hpf, filter_size, scratch);
+}
+
+void Inverse::dim(TiledArray3D<float>& data, int axis, size_t depth_limit, size_t row_limit, size_t col_limit, DWTWorkspace* workspace) const {
+    PROFILE_SCOPE(axis == 0 ? "dim0" : (axis == 1 ? "dim1" : "dim2"), -1, axis);
+    size_t n = axis == 0 ? row_limit : (axis == 1 ? col_limit : depth_limit);
+
+    // Each element is loaded and stored once; the line buffers stay in cache
+    size_t elements = depth_limit * row_limit * col_limit;
+    Profiler::add_work(2.0 * sizeof(float) * elements, kernel_flops(elements / max<size_t>(n, 1), n, filter_size));
+
+    vector<vector<float>> local_lines;
+    if (!workspace) {
+        local_lines.assign(thread_count(), vector<float>(2 * n));
     }
 
-    // Return the reconstructed data
-    return result;
-}
\ No newline at end of file
+    // Gather each line into a buffer, transform it and scatter it back
+    size_t outer = axis == 2 ? row_limit : depth_limit;
+    size_t inner = axis == 1 ? row_limit : col_limit;
+
+    parallel_for(workspace, 0, outer, [&](size_t a, size_t t) {
+        // Each thread uses its own input and output line buffers
+        float* in = workspace ? workspace->line(t) : local_lines[t].data();
+        float* out = in + n;
+
+        for (size_t b = 0; b < inner; ++b) {
+            size_t d = axis == 2 ? 0 : a;
+            size_t r = axis == 0 ? 0 : (axis == 1 ? b : a);
+            size_t c = axis == 1 ? 0 : b;
+
+            data.load_line(axis, d, r, c, n, in);
+            synthesize_line(in, n, out);
+            data.store_line(axis, d, r, c, n, out);
+        }
+    });
+}
+
+void Inverse::inverse_dwt_3d(TiledArray3D<float>& data, const AxisLevels& levels, DWTWorkspace* workspace) const {
+    // Calculate the bounds of each level, then undo the levels from the deepest up
+    vector<size_t> depth_levels, row_levels, col_levels;
+    level_bounds(data.get_depth(), data.get_rows(), data.get_cols(), levels, depth_levels, row_levels, col_levels);
+
+    for (int level = levels.max() - 1; level >= 0; --level) {
+        PROFILE_SCOPE("level", level + 1);
+        for (int axis = 2; axis >= 0; --axis) {
+            if (levels.splits(axis, level)) {
+                dim(data, axis, depth_levels[level], row_levels[level], col_levels[level], workspace);
+            }
+        }
+    }
+}
+
+// Undo one level within its bounds along the axes it split, in the reverse order of the forward passes
+void Inverse::inverse_level(Array3DView<float> bounds, const AxisLevels& levels, int level, DWTWorkspace* workspace) const {
+    if (levels.splits(2, level)) {
+        dim2(bounds, workspace);
+    }
+    if (levels.splits(1, level)) {
+        dim1(bounds, workspace);
+    }
+    if (levels.splits(0, level)) {
+        dim0(bounds, workspace);
+    }
+}
+
+// Perform the inverse transform with the compact layout: each deeper LLL band is copied into its own
+// packed buffer first, then the levels are reconstructed from the deepest up, each copied back into
+// the corner of the level above before that level is undone
+void Inverse::inverse_dwt_3d_compact(Array3DView<const float> data, Array3DView<float> result, const AxisLevels& levels, DWTWorkspace& workspace) const {
+    if (!same_layout(data, result)) {
+        copy_view(data, result);
+    }
+    workspace.reserve(data.get_depth(), data.get_rows(), data.get_cols());
+
+    vector<size_t>& depth_levels = workspace.depth_levels;
+    vector<size_t>& row_levels = workspace.row_levels;
+    vector<size_t>& col_levels = workspace.col_levels;
+    level_bounds(data.get_depth(), data.get_rows(), data.get_cols(), levels, depth_levels, row_levels, col_levels);
+
+    auto band = [&](int level) {
+        return level == 0 ? result : workspace.compact_level(level, depth_levels[level], row_levels[level], col_levels[level]);
+    };
+
+    // Gather the LLL band of every level into its buffer
+    for (int level = 1; level < levels.max(); ++level) {
+        copy_view(band(level - 1).subview(0, 0, 0, depth_levels[level], row_levels[level], col_levels[level]), band(level));
+    }
+
+    for (int level = levels.max() - 1; level >= 0; --level) {
+        PROFILE_SCOPE("level", level + 1);
+        Array3DView<float> bounds = band(level);
+        inverse_level(bounds, levels, level, &workspace);
+        if (level > 0) {
+            copy_view(bounds, band(level - 1).subview(0, 0, 0, depth_levels[level], row_levels[level], col_levels[level]));
+        }
+    }
+}
+
+// Perform the inverse 2D transform of every depth slice, each by one thread from its deepest level up
+// (or, with fewer slices than threads, level by level with the lines shared out)
+void Inverse::inverse_dwt_2d(Array3DView<const float> data, Array3DView<float> result, int levels, DWTWorkspace& workspace) const {
+    if (!same_layout(data, result)) {
+        copy_view(data, result);
+    }
+    size_t depth = data.get_depth();
+    size_t rows = data.get_rows();
+    size_t cols = data.get_cols();
+    workspace.reserve(depth, rows, cols);
+
+    vector<size_t>& depth_levels = workspace.depth_levels;
+    vector<size_t>& row_levels = workspace.row_levels;
+    vector<size_t>& col_levels = workspace.col_levels;
+    level_bounds(depth, rows, cols, AxisLevels(levels, levels, 0), depth_levels, row_levels, col_levels);
+
+    // With fewer slices than threads, the lines of each pass are shared out instead (see DWT::dwt_2d)
+    if (depth < workspace.threads().size()) {
+        for (int level = levels - 1; level >= 0; --level) {
+            Array3DView<float> bounds = result.subview(0, 0, 0, depth, row_levels[level], col_levels[level]);
+            dim1(slice_lines(bounds, 1), &workspace);
+            dim1(slice_lines(bounds, 0), &workspace);
+        }
+        return;
+    }
+    workspace.reserve_blocks(rows * cols);
+
+    // Each pass of each level copies and transforms every element of its band once
+    for (int level = 0; level < levels; ++level) {
+        size_t band = depth * row_levels[level] * col_levels[level];
+        Profiler::add_work(8.0 * sizeof(float) * band, kernel_flops(depth * col_levels[level], row_levels[level], filter_size) +
+                                                       kernel_flops(depth * row_levels[level], col_levels[level], filter_size));
+    }
+
+    workspace.threads().parallel_for(0, depth, [&](size_t d, size_t t) {
+        float* scratch = workspace.scratch_block(t, rows * cols);
+        for (int level = levels - 1; level >= 0; --level) {
+            Array3DView<float> bounds = result.subview(d, 0, 0, 1, row_levels[level], col_levels[level]);
+            dim_serial(bounds, 1, scratch);
+            dim_serial(bounds, 0, scratch);
+        }
+    });
+}
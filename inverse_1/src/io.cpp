@@ -1,32 +1,45 @@
 #include "io.h"
 
+// The vendored jbutil header has unused parameters in the allocator that jbutil::image instantiates here
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include "utilities/jbutil.h"
+#pragma GCC diagnostic pop
+
 /* 
  * Function to read the data from a binary file and return it as a 3D array
  * Parameters:
  * - filename: the name of the binary file to read
  * - shape_filename: the name of the shape file that contains the dimensions of the 3D array
+ * - dtype: the sample type stored in the file (float32, int16 or uint16); if empty the
+ *   optional fourth field of the shape file is used, defaulting to float32
  * Returns:
  * - A 3D array of float values read from the binary file
  */
-Array3D<float> IO::read(const string& filename, const string& shape_filename) {
+Array3D<float> IO::read(const string& filename, const string& shape_filename, const string& dtype) {
+    PROFILE_SCOPE("read");
     // Check if the file exists
     if (!filesystem::exists(filename)) {
         throw runtime_error("File does not exist: " + filename);
     }
     // Read the shape information from the shape file
-    vector<size_t> shape = read_shape(shape_filename);
+    string shape_dtype;
+    vector<size_t> shape = read_shape(shape_filename, shape_dtype);
 
     // Check if the shape information is valid
     if (shape.size() != 3) {
         throw runtime_error("Invalid shape information");
     }
 
+    // The command line dtype takes precedence over the shape file
+    string sample_type = !dtype.empty() ? dtype : (!shape_dtype.empty() ? shape_dtype : "float32");
+
     size_t depth = shape[0];
     size_t rows = shape[1];
     size_t cols = shape[2];
 
-    // Create a 3D array with the dimensions
-    Array3D<float> data(depth, rows, cols);
+    // Create a 3D array with the dimensions (every element is overwritten below)
+    Array3D<float> data(depth, rows, cols, uninitialised);
     ifstream file(filename, ios::binary);
 
     // Check if the file was opened successfully
@@ -34,28 +47,77 @@ Array3D<float> IO::read(const string& filename, const string& shape_filename) {
         throw runtime_error("Error opening file: " + filename);
     }
 
-    // Read the data from the file into the 3D array
-    for (size_t d = 0; d < depth; ++d) {
-        for (size_t r = 0; r < rows; ++r) {
-            file.read(reinterpret_cast<char*>(&data(d, r, 0)), cols * sizeof(float));
-            if (!file) {
-                throw runtime_error("Error reading row " + to_string(r) + " of depth " + to_string(d) + " from file: " + filename);
+    if (sample_type == "int16") {
+        read_widened<int16_t>(file, data, filename);
+    } else if (sample_type == "uint16") {
+        read_widened<uint16_t>(file, data, filename);
+    } else if (sample_type == "float32") {
+        // Read the data from the file into the 3D array
+        for (size_t d = 0; d < depth; ++d) {
+            for (size_t r = 0; r < rows; ++r) {
+                file.read(reinterpret_cast<char*>(&data(d, r, 0)), cols * sizeof(float));
+                if (!file) {
+                    throw runtime_error("Error reading row " + to_string(r) + " of depth " + to_string(d) + " from file: " + filename);
+                }
             }
         }
+    } else {
+        throw runtime_error("Unsupported data type: " + sample_type);
     }
 
     file.close(); 
     return data; 
 }
 
+/*
+ * Function to read 16-bit samples and widen them to float in a single pass
+ * Rows are read in chunks small enough to stay in cache and converted with
+ * vector instructions straight into the array, so each sample is touched once.
+ * Parameters:
+ * - file: the opened binary file, positioned at the first sample
+ * - data: the 3D array to fill
+ * - filename: the name of the file (for error messages)
+ */
+template <class S>
+void IO::read_widened(ifstream& file, Array3D<float>& data, const string& filename) {
+    size_t depth = data.get_depth();
+    size_t rows = data.get_rows();
+    size_t cols = data.get_cols();
+
+    // Read about 64 KB of samples at a time
+    size_t chunk_rows = max<size_t>(1, (64 * 1024) / max<size_t>(1, cols * sizeof(S)));
+    vector<S> buffer(chunk_rows * cols);
+
+    for (size_t d = 0; d < depth; ++d) {
+        for (size_t r = 0; r < rows; r += chunk_rows) {
+            size_t count = min(chunk_rows, rows - r);
+            file.read(reinterpret_cast<char*>(buffer.data()), count * cols * sizeof(S));
+            if (!file) {
+                throw runtime_error("Error reading row " + to_string(r) + " of depth " + to_string(d) + " from file: " + filename);
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                if constexpr (is_signed<S>::value) {
+                    widen_int16(buffer.data() + i * cols, &data(d, r + i, 0), cols);
+                } else {
+                    widen_uint16(buffer.data() + i * cols, &data(d, r + i, 0), cols);
+                }
+            }
+        }
+    }
+}
+
 /*
  * Function to read the shape information from a shape file
+ * The file holds "depth,rows,cols" optionally followed by the sample type,
+ * e.g. "78,512,512,int16".
  * Parameters:
  * - shape_filename: the name of the shape file that contains the dimensions of the 3D array
+ * - dtype: set to the sample type if the file specifies one, otherwise left empty
  * Returns:
  * - A vector of size_t values representing the dimensions of the 3D array
  */
-vector<size_t> IO::read_shape(const string& shape_filename) {
+vector<size_t> IO::read_shape(const string& shape_filename, string& dtype) {
     vector<size_t> shape;
     ifstream file(shape_filename);
     
@@ -71,6 +133,14 @@ vector<size_t> IO::read_shape(const string& shape_filename) {
     string item;
     
     while (getline(ss, item, ',')) {
+        // A non-numeric field names the sample type
+        if (!item.empty() && !isdigit(static_cast<unsigned char>(item[0]))) {
+            dtype = item;
+            while (!dtype.empty() && isspace(static_cast<unsigned char>(dtype.back()))) {
+                dtype.pop_back();
+            }
+            continue;
+        }
         shape.push_back(stoul(item));
     }
 
@@ -83,7 +153,8 @@ vector<size_t> IO::read_shape(const string& shape_filename) {
  * - data: the 3D array of data to be exported
  * - filename: the name of the binary file to write to
  */
-void IO::export_data(const Array3D<float>& data, const string& filename) {
+void IO::export_data(Array3DView<const float> data, const string& filename) {
+    PROFILE_SCOPE("export_data");
     ofstream file(filename, ios::binary);
     
     // Check if the file was opened successfully
@@ -106,11 +177,7 @@ void IO::export_data(const Array3D<float>& data, const string& filename) {
         file.write(reinterpret_cast<const char*>(&sub_rows), sizeof(sub_rows));
         file.write(reinterpret_cast<const char*>(&sub_cols), sizeof(sub_cols));
 
-        for (size_t d = 0; d < sub_depth; ++d) {
-            for (size_t r = 0; r < sub_rows; ++r) {
-                file.write(reinterpret_cast<const char*>(&data(offset_depth + d, offset_rows + r, offset_cols)), sub_cols * sizeof(float));
-            }
-        }
+        write_view(file, data.subview(offset_depth, offset_rows, offset_cols, sub_depth, sub_rows, sub_cols));
     };
 
     // Export each sub-band
@@ -126,6 +193,126 @@ void IO::export_data(const Array3D<float>& data, const string& filename) {
     file.close();
 }
 
+/* Function to export every subband of every decomposition level to a binary file
+ * The file starts with a header ("DWTS", version, full dimensions, levels and
+ * record count) followed by an index of SubbandRecord entries and then the
+ * coefficients themselves. Records are stored coarse-first (the final LLL band,
+ * then the detail bands from the deepest level up to level 1), so consumers can
+ * fetch the coarse levels by reading only the start of the file.
+ * Parameters:
+ * - data: the transformed 3D array
+ * - filename: the name of the binary file to write to
+ * - levels: the number of levels of decomposition used for the transform (along each axis);
+ *   the levels past the end of an axis have no bands that are high along it
+ */
+void IO::export_subbands(Array3DView<const float> data, const string& filename, const AxisLevels& levels) {
+    PROFILE_SCOPE("export_subbands");
+    ofstream file(filename, ios::binary);
+
+    // Check if the file was opened successfully
+    if (!file) {
+        throw runtime_error("Error opening file for writing: " + filename);
+    }
+
+    // Build the index, coarsest level first
+    vector<SubbandLayout> bands = subband_layout(data.get_depth(), data.get_rows(), data.get_cols(), levels);
+    vector<SubbandRecord> records;
+    for (const SubbandLayout& band : bands) {
+        SubbandRecord record = {};
+        record.level = static_cast<uint32_t>(band.level);
+        memcpy(record.tag, band.tag, 4);
+        record.depth = band.depth;
+        record.rows = band.rows;
+        record.cols = band.cols;
+        records.push_back(record);
+    }
+
+    // Assign the data offsets following the header and index
+    const size_t record_size = sizeof(uint32_t) + 4 + 4 * sizeof(uint64_t);
+    uint64_t offset = 4 + sizeof(uint32_t) + 3 * sizeof(uint64_t) + 2 * sizeof(uint32_t) + records.size() * record_size;
+    for (auto& record : records) {
+        record.offset = offset;
+        offset += record.depth * record.rows * record.cols * sizeof(float);
+    }
+
+    // Write the header
+    const uint32_t version = 1;
+    const uint64_t dims[3] = {data.get_depth(), data.get_rows(), data.get_cols()};
+    const uint32_t level_count = static_cast<uint32_t>(levels.max());
+    const uint32_t record_count = static_cast<uint32_t>(records.size());
+    file.write("DWTS", 4);
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+    file.write(reinterpret_cast<const char*>(&level_count), sizeof(level_count));
+    file.write(reinterpret_cast<const char*>(&record_count), sizeof(record_count));
+
+    // Write the index
+    for (const auto& record : records) {
+        file.write(reinterpret_cast<const char*>(&record.level), sizeof(record.level));
+        file.write(record.tag, 4);
+        file.write(reinterpret_cast<const char*>(&record.offset), sizeof(record.offset));
+        file.write(reinterpret_cast<const char*>(&record.depth), sizeof(record.depth));
+        file.write(reinterpret_cast<const char*>(&record.rows), sizeof(record.rows));
+        file.write(reinterpret_cast<const char*>(&record.cols), sizeof(record.cols));
+    }
+
+    // Write the coefficients of each subband
+    for (const SubbandLayout& band : bands) {
+        write_view(file, data.subview(band.origin[0], band.origin[1], band.origin[2], band.depth, band.rows, band.cols));
+    }
+
+    if (!file) {
+        throw runtime_error("Error writing subbands to file: " + filename);
+    }
+
+    file.close();
+}
+
+/* Function to read the index of a file written by export_subbands
+ * Parameters:
+ * - filename: the name of the subband file
+ * Returns:
+ * - The list of subband records, in file order
+ */
+vector<SubbandRecord> IO::read_subband_index(const string& filename) {
+    ifstream file(filename, ios::binary);
+
+    // Check if the file was opened successfully
+    if (!file) {
+        throw runtime_error("Error opening file: " + filename);
+    }
+
+    // Check the header
+    char magic[4];
+    uint32_t version, level_count, record_count;
+    uint64_t dims[3];
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(dims), sizeof(dims));
+    file.read(reinterpret_cast<char*>(&level_count), sizeof(level_count));
+    file.read(reinterpret_cast<char*>(&record_count), sizeof(record_count));
+    if (!file || memcmp(magic, "DWTS", 4) != 0 || version != 1) {
+        throw runtime_error("Not a subband file: " + filename);
+    }
+
+    // Read the index
+    vector<SubbandRecord> records(record_count);
+    for (auto& record : records) {
+        file.read(reinterpret_cast<char*>(&record.level), sizeof(record.level));
+        file.read(record.tag, 4);
+        file.read(reinterpret_cast<char*>(&record.offset), sizeof(record.offset));
+        file.read(reinterpret_cast<char*>(&record.depth), sizeof(record.depth));
+        file.read(reinterpret_cast<char*>(&record.rows), sizeof(record.rows));
+        file.read(reinterpret_cast<char*>(&record.cols), sizeof(record.cols));
+    }
+
+    if (!file) {
+        throw runtime_error("Error reading subband index from file: " + filename);
+    }
+
+    return records;
+}
+
 /* Function to construct filenames based on input parameters
  * Parameters:
  * - file_number: the file number
@@ -135,17 +322,18 @@ void IO::export_data(const Array3D<float>& data, const string& filename) {
  * Returns:
  * - A tuple containing the binary filename, shape filename, and output filename
  */
-tuple<string, string, string> IO::construct_filenames(const string& file_number, const string& dataset_type, const string& mr_type, const string& phase_type, const string& filter_type, int levels) {
+tuple<string, string, string> IO::construct_filenames(const string& file_number, const string& dataset_type, const string& mr_type, const string& phase_type, const string& filter_type, const AxisLevels& levels) {
     string binary_filename = "data/inputs/" + file_number + "_" + dataset_type + (dataset_type == "MR" ? "_" + mr_type + (mr_type == "T1DUAL" ? "_" + phase_type : "") : "") + ".bin";
     string shape_filename = "data/inputs/" + file_number + "_" + dataset_type + (dataset_type == "MR" ? "_" + mr_type + (mr_type == "T1DUAL" ? "_" + phase_type : "") : "") + "_shape.txt";
-    string output_filename = "data/outputs/" + file_number + "_" + dataset_type + (dataset_type == "MR" ? "_" + mr_type + (mr_type == "T1DUAL" ? "_" + phase_type : "") : "") + "_" + filter_type + "_" + to_string(levels) + ".bin";
+    string output_filename = "data/outputs/" + file_number + "_" + dataset_type + (dataset_type == "MR" ? "_" + mr_type + (mr_type == "T1DUAL" ? "_" + phase_type : "") : "") + "_" + filter_type + "_" + levels.name('-') + ".bin";
 
     return make_tuple(binary_filename, shape_filename, output_filename);
 }
 
 
 // Function to export the inverse transform data to a binary file
-bool IO::export_inverse(const Array3D<float>& data, const std::string& filename) {
+bool IO::export_inverse(Array3DView<const float> data, const std::string& filename) {
+    PROFILE_SCOPE("export_inverse");
     std::ofstream file(filename, std::ios::binary);
     
     // Check if the file was opened successfully
@@ -154,17 +342,181 @@ bool IO::export_inverse(const Array3D<float>& data, const std::string& filename)
         return false;
     }
 
+    // Write the data to the file without the dimensions
+    write_view(file, data);
+
+    file.close();
+    return true;
+}
+
+/* Function to read a PGM (grayscale) or PPM (colour) image into a 3D array
+ * Each channel becomes a depth slice, so a 2D transform (DWT::dwt_2d) decomposes
+ * each channel on its own. Only the binary formats (P5 and P6) are accepted, as
+ * jbutil::image reads the ASCII ones as binary.
+ * Parameters:
+ * - filename: the name of the image file
+ * - maxval: set to the maximum pixel value of the image (e.g. 255)
+ * Returns:
+ * - A channels x rows x cols array of the pixel values
+ */
+Array3D<float> IO::read_image(const string& filename, int& maxval) {
+    PROFILE_SCOPE("read");
+    ifstream file(filename, ios::binary);
+
+    // Check the format first, since jbutil::image aborts on input it cannot read
+    string magic;
+    if (!file || !(file >> magic) || (magic != "P5" && magic != "P6")) {
+        throw runtime_error("Not a binary PGM or PPM image (P5/P6): " + filename);
+    }
+    file.seekg(0);
+
+    // A floating-point image holds the pixels scaled to [0, 1]
+    jbutil::image<float> image;
+    image.load(file);
+    maxval = image.range();
+
+    Array3D<float> data(image.channels(), image.get_rows(), image.get_cols(), uninitialised);
+    for (int c = 0; c < image.channels(); ++c) {
+        for (int r = 0; r < image.get_rows(); ++r) {
+            for (int col = 0; col < image.get_cols(); ++col) {
+                data(c, r, col) = round(image(c, r, col) * maxval);
+            }
+        }
+    }
+    return data;
+}
+
+/* Function to write one slice as a PGM image, or three as a PPM image
+ * Parameters:
+ * - data: the slices (channels) to write
+ * - filename: the name of the image file
+ * - maxval: the maximum pixel value; values are rounded and clamped to [0, maxval]
+ */
+void IO::export_image(Array3DView<const float> data, const string& filename, int maxval) {
+    PROFILE_SCOPE("export_image");
+    if (data.get_depth() != 1 && data.get_depth() != 3) {
+        throw runtime_error("An image needs 1 or 3 channels, not " + to_string(data.get_depth()));
+    }
+    ofstream file(filename, ios::binary);
+    if (!file) {
+        throw runtime_error("Error opening file for writing: " + filename);
+    }
+
+    // jbutil::image scales floating-point pixels from [0, 1] and rounds them when saving
+    jbutil::image<float> image(data.get_rows(), data.get_cols(), data.get_depth(), maxval);
+    for (size_t c = 0; c < data.get_depth(); ++c) {
+        for (size_t r = 0; r < data.get_rows(); ++r) {
+            for (size_t col = 0; col < data.get_cols(); ++col) {
+                float value = round(data(c, r, col));
+                image(c, r, col) = min(max(value, 0.0f), static_cast<float>(maxval)) / maxval;
+            }
+        }
+    }
+    image.save(file);
+}
+
+/* Function to read one frame of a binary file of frames (a 4D series)
+ * Parameters:
+ * - filename: the name of the binary file
+ * - t: the index of the frame
+ * - dtype: the sample type stored in the file (float32, int16 or uint16; empty for float32)
+ * - frame: the array to fill, sized to one frame
+ */
+void IO::read_frame(const string& filename, size_t t, const string& dtype, Array3D<float>& frame) {
+    PROFILE_SCOPE("read_frame");
+    string sample_type = dtype.empty() ? "float32" : dtype;
+    size_t sample_size = sample_type == "float32" ? sizeof(float) : sizeof(int16_t);
+
+    ifstream file(filename, ios::binary);
+    if (!file) {
+        throw runtime_error("Error opening file: " + filename);
+    }
+    file.seekg(static_cast<streamoff>(t * frame.size() * sample_size));
+
+    if (sample_type == "int16") {
+        read_widened<int16_t>(file, frame, filename);
+    } else if (sample_type == "uint16") {
+        read_widened<uint16_t>(file, frame, filename);
+    } else if (sample_type == "float32") {
+        for (size_t d = 0; d < frame.get_depth(); ++d) {
+            for (size_t r = 0; r < frame.get_rows(); ++r) {
+                file.read(reinterpret_cast<char*>(&frame(d, r, 0)), frame.get_cols() * sizeof(float));
+                if (!file) {
+                    throw runtime_error("Error reading frame " + to_string(t) + " from file: " + filename);
+                }
+            }
+        }
+    } else {
+        throw runtime_error("Unsupported data type: " + sample_type);
+    }
+}
+
+/* Function to create a binary file for a series written a frame at a time
+ * Parameters:
+ * - filename: the name of the binary file
+ * - frames: the number of frames
+ * - frame_elements: the number of values in each frame
+ */
+void IO::create_series(const string& filename, size_t frames, size_t frame_elements) {
+    ofstream file(filename, ios::binary | ios::trunc);
+    if (!file) {
+        throw runtime_error("Error opening file for writing: " + filename);
+    }
+    file.close();
+    filesystem::resize_file(filename, frames * frame_elements * sizeof(float));
+}
+
+/* Function to write one frame of a series in place
+ * Parameters:
+ * - frame: the frame to write
+ * - filename: the name of a file made by create_series
+ * - t: the index of the frame
+ */
+void IO::export_frame(Array3DView<const float> frame, const string& filename, size_t t) {
+    PROFILE_SCOPE("export_frame");
+    fstream file(filename, ios::binary | ios::in | ios::out);
+    if (!file) {
+        throw runtime_error("Error opening file for writing: " + filename);
+    }
+    file.seekp(static_cast<streamoff>(t * frame.size() * sizeof(float)));
+    write_view(file, frame);
+    if (!file) {
+        throw runtime_error("Error writing frame " + to_string(t) + " to file: " + filename);
+    }
+}
+
+/* Function to write the elements of a view to a binary file in row-major order
+ * Parameters:
+ * - file: the opened output file
+ * - data: the view to write (any strides)
+ */
+void IO::write_view(ostream& file, Array3DView<const float> data) {
     size_t depth = data.get_depth();
     size_t rows = data.get_rows();
     size_t cols = data.get_cols();
 
-    // Write the data to the file without the dimensions
+    if (cols == 0) {
+        return;
+    }
+
+    // Rows that are contiguous in memory are written directly
+    if (data.get_col_stride() == 1) {
+        for (size_t d = 0; d < depth; ++d) {
+            for (size_t r = 0; r < rows; ++r) {
+                file.write(reinterpret_cast<const char*>(&data(d, r, 0)), cols * sizeof(float));
+            }
+        }
+        return;
+    }
+
+    // Otherwise gather each row into a buffer first
+    vector<float> row(cols);
     for (size_t d = 0; d < depth; ++d) {
         for (size_t r = 0; r < rows; ++r) {
-            file.write(reinterpret_cast<const char*>(&data(d, r, 0)), cols * sizeof(float));
+            for (size_t c = 0; c < cols; ++c) {
+                row[c] = data(d, r, c);
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), cols * sizeof(float));
         }
     }
-
-    file.close();
-    return true;
 }
\ No newline at end of file
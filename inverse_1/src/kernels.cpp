@@ -0,0 +1,96 @@
+#include "kernels.h"
+#include <cstdlib>
+#include <stdexcept>
+
+// Instruction set override (set from DWT_ISA or set_isa); empty for auto
+static string& isa_override() {
+    static string name = getenv("DWT_ISA") ? getenv("DWT_ISA") : "";
+    return name;
+}
+
+// Check whether the CPU supports an instruction set
+static bool supported(ISA isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (isa) {
+        case ISA::AVX512: return __builtin_cpu_supports("avx512f");
+        case ISA::AVX2: return __builtin_cpu_supports("avx2");
+        case ISA::SSE2: return true;
+    }
+#endif
+    return isa == ISA::SSE2;
+}
+
+// Get the best instruction set supported by this CPU
+ISA detect_isa() {
+    if (supported(ISA::AVX512)) {
+        return ISA::AVX512;
+    }
+    if (supported(ISA::AVX2)) {
+        return ISA::AVX2;
+    }
+    return ISA::SSE2;
+}
+
+/*
+ * Get the instruction set used for the kernels
+ * Returns:
+ * - the overridden instruction set if one was given, otherwise the best one the CPU supports
+ */
+ISA active_isa() {
+    const string& name = isa_override();
+    if (name.empty() || name == "auto") {
+        return detect_isa();
+    }
+
+    ISA isa;
+    if (name == "sse2") {
+        isa = ISA::SSE2;
+    } else if (name == "avx2") {
+        isa = ISA::AVX2;
+    } else if (name == "avx512") {
+        isa = ISA::AVX512;
+    } else {
+        throw runtime_error("Unknown instruction set: " + name + " (expected auto, sse2, avx2 or avx512)");
+    }
+
+    if (!supported(isa)) {
+        throw runtime_error(string("Instruction set not supported by this CPU: ") + isa_name(isa));
+    }
+    return isa;
+}
+
+// Override the instruction set used for the kernels
+void set_isa(const string& name) {
+    isa_override() = name;
+    active_isa(); // Check the name and CPU support now rather than at the first transform
+}
+
+// Get the name of an instruction set
+const char* isa_name(ISA isa) {
+    switch (isa) {
+        case ISA::AVX512: return "avx512";
+        case ISA::AVX2: return "avx2";
+        case ISA::SSE2: return "sse2";
+    }
+    return "unknown";
+}
+
+// Get the analysis kernel for a filter length, compiled for the active instruction set
+LineKernel analysis_kernel(size_t filter_size, bool contiguous) {
+    switch (active_isa()) {
+        case ISA::AVX512: return avx512::analysis_kernel(filter_size, contiguous);
+        case ISA::AVX2: return avx2::analysis_kernel(filter_size, contiguous);
+        case ISA::SSE2: break;
+    }
+    return sse2::analysis_kernel(filter_size, contiguous);
+}
+
+// Get the synthesis kernel for a filter length, compiled for the active instruction set
+LineKernel synthesis_kernel(size_t filter_size, bool contiguous) {
+    switch (active_isa()) {
+        case ISA::AVX512: return avx512::synthesis_kernel(filter_size, contiguous);
+        case ISA::AVX2: return avx2::synthesis_kernel(filter_size, contiguous);
+        case ISA::SSE2: break;
+    }
+    return sse2::synthesis_kernel(filter_size, contiguous);
+}
@@ -0,0 +1,3 @@
+// Line kernels compiled for AVX2 (built with -mavx2, see the Makefile)
+#define KERNEL_ISA avx2
+#include "kernels_impl.h"
@@ -0,0 +1,3 @@
+// Line kernels compiled for AVX-512 (built with -mavx512f, see the Makefile)
+#define KERNEL_ISA avx512
+#include "kernels_impl.h"
@@ -0,0 +1,3 @@
+// Line kernels compiled for the x86-64 baseline (SSE2)
+#define KERNEL_ISA sse2
+#include "kernels_impl.h"
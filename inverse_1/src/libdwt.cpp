@@ -0,0 +1,145 @@
+#include "libdwt.h"
+#include "DWT.h"
+#include "denoise.h"
+#include <exception>
+#include <string>
+
+// Wavelet transforms of one filter, with their thread pool and scratch memory
+struct dwt_context {
+    DWT dwt;
+    Inverse inverse;
+    DWTWorkspace workspace;
+
+    dwt_context(const FilterInfo& filter, size_t threads)
+        : dwt(filter.lpf, filter.hpf, filter.size), inverse(filter.Ilpf, filter.Ihpf, filter.size),
+          workspace(1, 1, 1, filter.size, threads > 0 ? threads : thread_count()) {}
+};
+
+namespace {
+
+// Message of the last error on each thread
+thread_local string last_error;
+
+/*
+ * Run a call of the C interface, turning exceptions into an error code
+ * Parameters:
+ * - func: the body of the call
+ * Returns:
+ * - 0 on success, -1 if func threw (the message is kept for dwt_last_error)
+ */
+template <class Func>
+int guarded(Func func) {
+    try {
+        last_error.clear();
+        func();
+        return 0;
+    } catch (const exception& e) {
+        last_error = e.what();
+    } catch (...) {
+        last_error = "Unknown error";
+    }
+    return -1;
+}
+
+// Check that every stride of a caller-owned volume is non-negative
+void check_strides(const ptrdiff_t* strides) {
+    for (int i = 0; i < 3; ++i) {
+        if (strides[i] < 0) {
+            throw invalid_argument("Negative strides are not supported");
+        }
+    }
+}
+
+// Check the arguments shared by every transform call
+void check_arguments(const dwt_context* context, const void* input, const ptrdiff_t* input_strides, const void* output,
+                     const ptrdiff_t* output_strides, const size_t* dims, int levels) {
+    if (!context || !input || !input_strides || !output || !output_strides || !dims) {
+        throw invalid_argument("Null argument");
+    }
+    if (dims[0] == 0 || dims[1] == 0 || dims[2] == 0) {
+        throw invalid_argument("Volume dimensions must be positive");
+    }
+    if (levels < 1) {
+        throw invalid_argument("The number of levels must be at least 1");
+    }
+    check_strides(input_strides);
+    check_strides(output_strides);
+}
+
+// View of a caller-owned volume
+template <class T>
+Array3DView<T> view(T* data, const ptrdiff_t strides[3], const size_t dims[3]) {
+    return Array3DView<T>(data, dims[0], dims[1], dims[2], strides[0], strides[1], strides[2]);
+}
+
+} // namespace
+
+int dwt_api_version(void) {
+    return DWT_API_VERSION;
+}
+
+const char* dwt_last_error(void) {
+    return last_error.c_str();
+}
+
+dwt_context* dwt_create(const char* filter, size_t threads) {
+    dwt_context* context = nullptr;
+    guarded([&]() {
+        const FilterInfo* info = filter ? find_filter(filter) : nullptr;
+        if (!info) {
+            throw invalid_argument(string("Unknown filter: ") + (filter ? filter : "(null)"));
+        }
+        context = new dwt_context(*info, threads);
+    });
+    return context;
+}
+
+void dwt_destroy(dwt_context* context) {
+    delete context;
+}
+
+int dwt_forward(dwt_context* context, const float* input, const ptrdiff_t input_strides[3],
+                float* output, const ptrdiff_t output_strides[3], const size_t dims[3], int levels) {
+    return guarded([&]() {
+        check_arguments(context, input, input_strides, output, output_strides, dims, levels);
+        context->dwt.dwt_3d(view(input, input_strides, dims), view(output, output_strides, dims), levels, context->workspace);
+    });
+}
+
+int dwt_inverse(dwt_context* context, const float* input, const ptrdiff_t input_strides[3],
+                float* output, const ptrdiff_t output_strides[3], const size_t dims[3], int levels) {
+    return guarded([&]() {
+        check_arguments(context, input, input_strides, output, output_strides, dims, levels);
+        context->inverse.inverse_dwt_3d(view(input, input_strides, dims), view(output, output_strides, dims), levels, context->workspace);
+    });
+}
+
+int dwt_update(dwt_context* context, const float* previous, const ptrdiff_t previous_strides[3],
+               const float* current, const ptrdiff_t current_strides[3],
+               float* coefficients, const ptrdiff_t coefficient_strides[3], const size_t dims[3], int levels,
+               const size_t* changed, size_t changed_count) {
+    return guarded([&]() {
+        check_arguments(context, previous, previous_strides, coefficients, coefficient_strides, dims, levels);
+        if (!current || !current_strides || (!changed && changed_count > 0)) {
+            throw invalid_argument("Null argument");
+        }
+        check_strides(current_strides);
+        const size_t slice_dims[3] = {changed_count, dims[1], dims[2]};
+        context->dwt.dwt_3d_update(view(previous, previous_strides, slice_dims), view(current, current_strides, slice_dims),
+                                   view(coefficients, coefficient_strides, dims), vector<size_t>(changed, changed + changed_count),
+                                   levels, context->workspace);
+    });
+}
+
+int dwt_denoise(dwt_context* context, const float* input, const ptrdiff_t input_strides[3],
+                float* output, const ptrdiff_t output_strides[3], const size_t dims[3], int levels,
+                float threshold, float* applied) {
+    return guarded([&]() {
+        check_arguments(context, input, input_strides, output, output_strides, dims, levels);
+        float used = Denoise::run(context->dwt, context->inverse, view(input, input_strides, dims),
+                                  view(output, output_strides, dims), levels, threshold, context->workspace);
+        if (applied) {
+            *applied = used;
+        }
+    });
+}
@@ -2,36 +2,151 @@
 #include <stdexcept>
 #include <string>
 #include <filesystem>
+#include <vector>
+#include <sstream>
 #include "io.h"
 #include "DWT.h"
+#include "server.h"
+#include "sweep.h"
+#include "series.h"
 
 using namespace std;
 
+// Split a comma separated list
+static vector<string> split(const string& list) {
+    vector<string> items;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
 int main(int argc, char* argv[]) {
     try {
+        // Separate the "--name=value" options from the positional arguments
+        vector<string> args;
+        TransformOptions options;
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg.rfind("--", 0) != 0) {
+                args.push_back(arg);
+                continue;
+            }
+            size_t eq = arg.find('=');
+            string name = arg.substr(2, eq == string::npos ? string::npos : eq - 2);
+            string value = eq == string::npos ? "" : arg.substr(eq + 1);
+
+            if (name == "dicom") {
+                options.dicom_directory = value;
+            } else if (name == "image") {
+                options.image_file = value;
+            } else if (name == "2d") {
+                options.slices_2d = true;
+            } else if (name == "time-levels") {
+                options.time_levels = stoi(value);
+            } else if (name == "dtype") {
+                options.dtype = value;
+            } else if (name == "layout") {
+                options.layout = value;
+            } else if (name == "isa") {
+                options.isa = value;
+            } else if (name == "trace") {
+                options.profile = true;
+                options.trace_file = value;
+            } else if (name == "counters") {
+                options.counters = true;
+                options.counter_list = value;
+            } else if (name == "roofline") {
+                options.roofline = true;
+            } else if (name == "memory") {
+                options.memory = true;
+            } else if (name == "dry-run") {
+                options.dry_run = true;
+            } else if (name == "threads") {
+                options.threads = stoul(value);
+            } else if (name == "autotune") {
+                options.autotune = true;
+            } else if (name == "no-tuning") {
+                options.use_tuning = false;
+            } else if (name == "sweep") {
+                options.sweep = true;
+                options.sweep_file = value;
+            } else if (name == "stats") {
+                options.stats = true;
+            } else if (name == "threshold") {
+                options.threshold = stof(value);
+            } else if (name == "serve") {
+                options.socket_path = value.empty() ? "/tmp/dwt.sock" : value;
+            } else {
+                throw invalid_argument("Unknown option: " + arg);
+            }
+        }
+
+        // Run as a service instead of transforming the volume given by the arguments
+        if (!options.socket_path.empty()) {
+            if (!options.isa.empty()) {
+                set_isa(options.isa);
+            }
+            Server server(options.socket_path);
+            server.run();
+            return 0;
+        }
+
         // Check if the number of arguments is valid
-        if (argc != 5 && argc != 6 && argc != 7) {
-            throw invalid_argument("Usage: " + string(argv[0]) + " <file number> <dataset type (CT/MR)> <filter type> <levels> [MR type (T1DUAL/T2SPIR)] [Phase type (InPhase/OutPhase)]");
+        if (args.size() < 4 || args.size() > 6) {
+            throw invalid_argument("Usage: " + string(argv[0]) + " <file number> <dataset type (CT/MR)> <filter type> <levels (N or rows,cols,depth)> [MR type (T1DUAL/T2SPIR)] [Phase type (InPhase/OutPhase)] [--dicom=<series directory>] [--image=<PGM/PPM file>] [--2d] [--time-levels=N] [--dtype=float32|int16|uint16] [--layout=linear|compact|tiled|tiled-linear] [--isa=auto|sse2|avx2|avx512] [--threads=N] [--autotune] [--no-tuning] [--trace[=<trace file>]] [--counters[=<event,...>]] [--roofline] [--memory] [--stats [--threshold=<value>]] [--dry-run] [--sweep[=<csv file>] [--threshold=<value>]]\n       " + string(argv[0]) + " --serve[=<socket path>]");
         }
 
         // Parse command line arguments
-        string file_number = argv[1];
-        string dataset_type = argv[2];
-        string filter_type = argv[3];
-        int levels = stoi(argv[4]);
+        string file_number = args[0];
+        string dataset_type = args[1];
+        string filter_type = args[2];
+
+        // A sweep takes lists of filters ("all" for every registered one) and levels
+        vector<string> filters;
+        vector<int> level_list;
+        if (options.sweep) {
+            filters = filter_type == "all" ? filter_names() : split(filter_type);
+            for (const string& level : split(args[3])) {
+                level_list.push_back(stoi(level));
+            }
+            if (filters.empty() || level_list.empty()) {
+                throw invalid_argument("A sweep needs at least one filter and one number of levels");
+            }
+            filter_type = filters[0];
+        }
+        // Otherwise the levels are one number, or one per axis (rows,cols,depth) to stop the short axes early
+        AxisLevels levels = options.sweep ? AxisLevels(level_list[0]) : AxisLevels::parse(args[3]);
 
         // Optional arguments for MR dataset type
-        string mr_type = argc >= 6 ? argv[5] : "";
-        string phase_type = argc == 7 ? argv[6] : "";
+        string mr_type = args.size() >= 5 ? args[4] : "";
+        string phase_type = args.size() == 6 ? args[5] : "";
 
         // Construct filenames based on input parameters
         auto [binary_filename, shape_filename, output_filename] = IO::construct_filenames(file_number, dataset_type, mr_type, phase_type, filter_type, levels);
 
+        if (options.sweep) {
+            perform_sweep(binary_filename, shape_filename, filters, level_list, options);
+            return 0;
+        }
+
         // Create the outputs directory if it does not exist
         filesystem::create_directories("data/outputs");
 
+        // A shape file with four dimensions holds a series of volumes, transformed in 4D
+        string shape_dtype;
+        if (options.dicom_directory.empty() && options.image_file.empty() && filesystem::exists(shape_filename)
+            && IO::read_shape(shape_filename, shape_dtype).size() == 4) {
+            perform_series_transform(binary_filename, shape_filename, output_filename, filter_type, levels, options);
+            return 0;
+        }
+
         // Perform the 3D wavelet transform
-        perform_transform(binary_filename, output_filename, filter_type, levels);
+        perform_transform(binary_filename, output_filename, filter_type, levels, options);
         
     } catch (const invalid_argument& e) {
         // Handle invalid argument exceptions
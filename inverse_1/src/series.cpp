@@ -0,0 +1,407 @@
+#include "series.h"
+#include "tuning.h"
+
+// Constructor for the series transform, with the spatial transforms of one frame
+SeriesDWT::SeriesDWT(const FilterInfo& filter, DWTWorkspace& workspace)
+    : filter(filter), dwt(filter.lpf, filter.hpf, filter.size), inverse_dwt(filter.Ilpf, filter.Ihpf, filter.size), workspace(workspace) {}
+
+/*
+ * Function to count the temporal levels a series allows
+ * Each level pairs up the frames of the one before, so its length must be even.
+ * Parameters:
+ * - frames: number of frames in the series
+ * Returns:
+ * - the number of times the length can be halved while it stays even
+ */
+int SeriesDWT::max_time_levels(size_t frames) {
+    int levels = 0;
+    for (size_t n = frames; n >= 2 && n % 2 == 0; n /= 2) {
+        ++levels;
+    }
+    return levels;
+}
+
+/*
+ * Function to perform the forward 4D transform of a series
+ * Frames are read one at a time and transformed in 3D in place, then passed to the
+ * first temporal level, which makes each low/high pair as soon as the frames under
+ * the filter have arrived (see push).
+ * Parameters:
+ * - frames: number of frames in the series
+ * - read: reads frame t of the input series
+ * - write: writes frame t of the coefficients
+ * - levels: spatial levels of each frame
+ * - time_levels: temporal levels
+ */
+void SeriesDWT::forward(size_t frames, const FrameReader& read, const FrameWriter& write, const AxisLevels& levels, int time_levels) const {
+    if (time_levels < 0 || time_levels > max_time_levels(frames)) {
+        throw runtime_error("A series of " + to_string(frames) + " frames allows at most " + to_string(max_time_levels(frames)) + " temporal levels");
+    }
+
+    vector<ForwardStage> stages(time_levels);
+    for (int level = 0; level < time_levels; ++level) {
+        stages[level].length = frames >> level;
+    }
+
+    for (size_t t = 0; t < frames; ++t) {
+        Frame frame = make_shared<Array3D<float>>();
+        read(t, *frame);
+        {
+            PROFILE_SCOPE("spatial");
+            dwt.dwt_3d(frame->view(), frame->view(), levels, workspace);
+        }
+
+        if (stages.empty()) {
+            write(t, frame->view());
+        } else {
+            push(stages, 0, frame, write);
+        }
+    }
+}
+
+/*
+ * Function to pass a frame into a temporal level of the forward transform
+ * Pair i filters frames 2i to 2i + taps - 1 (wrapping around to the start of the level),
+ * so it is made once frame min(2i + taps - 1, length - 1) has arrived. Its high frame is
+ * written at once, at half + i of the region of the level, and its low frame is passed
+ * to the next level (or written at i after the last level). The frames below 2(i + 1)
+ * are then no longer needed, except the first ones kept for the wrap-around.
+ * Parameters:
+ * - stages: the temporal levels
+ * - level: the level to pass the frame to
+ * - frame: the next frame of the level
+ * - write: writes frame t of the coefficients
+ */
+void SeriesDWT::push(vector<ForwardStage>& stages, size_t level, Frame frame, const FrameWriter& write) const {
+    ForwardStage& stage = stages[level];
+    const size_t taps = filter.size;
+    const size_t half = stage.length / 2;
+
+    stage.window.push_back(frame);
+    if (stage.start.size() + 2 < taps) {
+        stage.start.push_back(frame);
+    }
+    ++stage.received;
+
+    while (stage.next_pair < half && stage.received > min(2 * stage.next_pair + taps - 1, stage.length - 1)) {
+        size_t i = stage.next_pair;
+
+        // The frames under the filter, from the window or (past the end of the level) from the start;
+        // a filter longer than the level wraps around it more than once
+        vector<const Array3D<float>*> inputs(taps);
+        for (size_t j = 0; j < taps; ++j) {
+            size_t k = 2 * i + j;
+            inputs[j] = k < stage.length ? stage.window[k - stage.base].get() : stage.start[k % stage.length].get();
+        }
+
+        Frame low = make_shared<Array3D<float>>(frame->get_depth(), frame->get_rows(), frame->get_cols(), uninitialised);
+        Frame high = make_shared<Array3D<float>>(frame->get_depth(), frame->get_rows(), frame->get_cols(), uninitialised);
+        {
+            PROFILE_SCOPE("temporal", static_cast<int>(level), 3);
+            analyze_frames(inputs, *low, *high);
+        }
+        ++stage.next_pair;
+
+        // Drop the frames no later pair reads from the window
+        while (stage.base < 2 * stage.next_pair && !stage.window.empty()) {
+            stage.window.pop_front();
+            ++stage.base;
+        }
+
+        write(half + i, high->view());
+        high.reset();
+        if (level + 1 < stages.size()) {
+            push(stages, level + 1, low, write);
+        } else {
+            write(i, low->view());
+        }
+    }
+}
+
+/*
+ * Function to perform the inverse 4D transform of a series
+ * The reconstructed frames are pulled from the first temporal level, each one transformed
+ * back in 3D and written as soon as every pair adding into it is in. The pairs wrap around
+ * each level as in the forward transform, so every level starts from the pair that lets
+ * the level below it hand on its frames soonest (see pull), and the frames of the series
+ * are written starting part of the way through.
+ * Parameters:
+ * - frames: number of frames in the series
+ * - read: reads frame t of the coefficients
+ * - write: writes frame t of the reconstructed series
+ * - levels: spatial levels of each frame
+ * - time_levels: temporal levels
+ */
+void SeriesDWT::inverse(size_t frames, const FrameReader& read, const FrameWriter& write, const AxisLevels& levels, int time_levels) const {
+    if (time_levels < 0 || time_levels > max_time_levels(frames)) {
+        throw runtime_error("A series of " + to_string(frames) + " frames allows at most " + to_string(max_time_levels(frames)) + " temporal levels");
+    }
+
+    // The first frame a level completes is the first low frame the level above it reads
+    vector<InverseStage> stages(time_levels);
+    size_t first_pair = 0;
+    for (int level = time_levels - 1; level >= 0; --level) {
+        InverseStage& stage = stages[level];
+        stage.length = frames >> level;
+        stage.first_pair = first_pair;
+        stage.first_frame = (2 * first_pair + filter.size - 2) % stage.length;
+        stage.frames.resize(stage.length);
+        stage.added.assign(stage.length, 0);
+        first_pair = stage.first_frame;
+    }
+
+    Array3D<float> result;
+    for (size_t n = 0; n < frames; ++n) {
+        size_t t = stages.empty() ? n : (stages[0].first_frame + n) % frames;
+        Frame frame;
+        if (stages.empty()) {
+            frame = make_shared<Array3D<float>>();
+            read(t, *frame);
+        } else {
+            frame = pull(stages, 0, read);
+        }
+
+        PROFILE_SCOPE("spatial");
+        inverse_dwt.inverse_dwt_3d(*frame, result, levels, workspace);
+        write(t, result.view());
+    }
+}
+
+/*
+ * Function to get the next reconstructed frame of a temporal level
+ * Pair i adds into frames 2i to 2i + taps - 1, wrapping around the level, so every frame
+ * of an even length gets taps / 2 pairs (one more for the even frames of an odd filter).
+ * The pairs are added one at a time, from first_pair onwards, with the low frame pulled
+ * from the next level (or read at i after the last level) and the high frame read at
+ * half + i, until the next frame to hand on is complete. Starting at frame
+ * 2 * first_pair + taps - 2 (the first that the pairs before the wrap-around complete),
+ * the frames are handed on in order, and the first taps - 2 frames are held until the
+ * last pairs come round to them, so a level holds about 2 * taps frames at most.
+ * Parameters:
+ * - stages: the temporal levels
+ * - level: the level to get the frame of
+ * - read: reads frame t of the coefficients
+ * Returns:
+ * - the next frame of the level, frame (first_frame + frames handed on so far) % length
+ */
+SeriesDWT::Frame SeriesDWT::pull(vector<InverseStage>& stages, size_t level, const FrameReader& read) const {
+    InverseStage& stage = stages[level];
+    const size_t taps = filter.size;
+    const size_t half = stage.length / 2;
+    const size_t t = (stage.first_frame + stage.handed_on) % stage.length;
+    const size_t needed = t % 2 == 0 ? (taps + 1) / 2 : taps / 2;
+
+    while (stage.added[t] < needed) {
+        if (stage.pairs_added == half) {
+            throw logic_error("Temporal level " + to_string(level) + " ran out of pairs before frame " + to_string(t) + " was complete");
+        }
+        size_t i = (stage.first_pair + stage.pairs_added) % half;
+
+        Frame low;
+        if (level + 1 < stages.size()) {
+            low = pull(stages, level + 1, read);
+        } else {
+            low = make_shared<Array3D<float>>();
+            read(i, *low);
+        }
+        Array3D<float> high;
+        read(half + i, high);
+
+        // Start (at zero) the frames this pair is the first to add into
+        vector<Array3D<float>*> outputs;
+        for (size_t j = 0; j < taps; ++j) {
+            size_t k = (2 * i + j) % stage.length;
+            if (!stage.frames[k]) {
+                stage.frames[k] = make_shared<Array3D<float>>(high.get_depth(), high.get_rows(), high.get_cols());
+            }
+            outputs.push_back(stage.frames[k].get());
+            ++stage.added[k];
+        }
+
+        {
+            PROFILE_SCOPE("temporal", static_cast<int>(level), 3);
+            synthesize_frames(*low, high, outputs);
+        }
+        ++stage.pairs_added;
+    }
+
+    Frame frame = stage.frames[t];
+    stage.frames[t].reset();
+    ++stage.handed_on;
+    return frame;
+}
+
+/*
+ * Function to convolve and subsample a set of frames along time
+ * Every element of the frames is one temporal line, so the rows of the frames are
+ * shared out between the workspace threads and each walks its rows element by element.
+ * Parameters:
+ * - frames: the frames under the filter, in order
+ * - low, high: receive the low-pass and high-pass frames
+ */
+void SeriesDWT::analyze_frames(const vector<const Array3D<float>*>& frames, Array3D<float>& low, Array3D<float>& high) const {
+    const size_t taps = frames.size();
+    const size_t rows = low.get_rows();
+    const size_t cols = low.get_cols();
+    const float* lpf = filter.lpf;
+    const float* hpf = filter.hpf;
+
+    Profiler::add_work(sizeof(float) * low.size() * (taps + 2), 4.0 * low.size() * taps);
+
+    workspace.threads().parallel_for(0, low.get_depth() * rows, [&](size_t line, size_t) {
+        size_t d = line / rows, r = line % rows;
+        float* out_low = &low(d, r, 0);
+        float* out_high = &high(d, r, 0);
+
+        for (size_t c = 0; c < cols; ++c) {
+            out_low[c] = 0.0f;
+            out_high[c] = 0.0f;
+        }
+        // Sum in the same order as the line kernels, so each element matches a transform along an axis
+        for (size_t j = 0; j < taps; ++j) {
+            const float* x = &(*frames[j])(d, r, 0);
+            for (size_t c = 0; c < cols; ++c) {
+                out_low[c] += lpf[j] * x[c];
+                out_high[c] += hpf[j] * x[c];
+            }
+        }
+    });
+}
+
+/*
+ * Function to upsample and combine a low and a high frame along time
+ * Parameters:
+ * - low, high: the frames of one pair
+ * - outputs: the frames the pair adds into, one per tap (the same frame more than once if the filter is longer than the level)
+ */
+void SeriesDWT::synthesize_frames(const Array3D<float>& low, const Array3D<float>& high, const vector<Array3D<float>*>& outputs) const {
+    const size_t rows = low.get_rows();
+    const size_t cols = low.get_cols();
+    const float* lpf = filter.Ilpf;
+    const float* hpf = filter.Ihpf;
+
+    Profiler::add_work(sizeof(float) * low.size() * (2 + 2 * outputs.size()), 4.0 * low.size() * outputs.size());
+
+    workspace.threads().parallel_for(0, low.get_depth() * rows, [&](size_t line, size_t) {
+        size_t d = line / rows, r = line % rows;
+        const float* low_val = &low(d, r, 0);
+        const float* high_val = &high(d, r, 0);
+
+        for (size_t j = 0; j < outputs.size(); ++j) {
+            float* y = &(*outputs[j])(d, r, 0);
+            for (size_t c = 0; c < cols; ++c) {
+                y[c] += (lpf[j] * low_val[c]) + (hpf[j] * high_val[c]);
+            }
+        }
+    });
+}
+
+/*
+ * Perform the 4D wavelet transform of a series and its inverse, and export both
+ * The series is read from the binary file a frame at a time and the coefficients and
+ * the reconstruction are written a frame at a time, so only the frames under the
+ * filter of each temporal level are held at once.
+ * Parameters:
+ * - binary_filename: the name of the binary file of frames
+ * - shape_filename: the name of its shape file ("frames,depth,rows,cols[,dtype]")
+ * - output_filename: the name of the binary file to write the coefficients to
+ * - filter_type: the type of wavelet filter to use
+ * - levels: the spatial levels of each frame
+ * - options: optional settings (time_levels, threads, isa, memory)
+ */
+void perform_series_transform(const string& binary_filename, const string& shape_filename, const string& output_filename,
+                              const string& filter_type, const AxisLevels& levels, const TransformOptions& options) {
+    const FilterInfo* filter = find_filter(filter_type);
+    if (!filter) {
+        cerr << "Failed to get filters for type: " << filter_type << endl;
+        return;
+    }
+
+    try {
+        if (!options.dicom_directory.empty() || !options.image_file.empty() || options.slices_2d || options.autotune || options.dry_run
+            || (!options.layout.empty() && options.layout != "linear")) {
+            throw runtime_error("A series is read from its binary file and transformed with the linear layout only");
+        }
+
+        string dtype;
+        vector<size_t> shape = IO::read_shape(shape_filename, dtype);
+        if (shape.size() != 4) {
+            throw runtime_error("Invalid shape information");
+        }
+        if (!options.dtype.empty()) {
+            dtype = options.dtype;
+        }
+        size_t frames = shape[0], depth = shape[1], rows = shape[2], cols = shape[3];
+
+        // By default, as many temporal levels as spatial ones, if the length of the series allows
+        int time_levels = options.time_levels >= 0 ? options.time_levels : min(levels.max(), SeriesDWT::max_time_levels(frames));
+
+        if (!options.isa.empty()) {
+            set_isa(options.isa);
+        }
+        size_t threads = options.threads ? options.threads : thread_count();
+        if (options.profile || options.counters) {
+            Profiler::enable(options.trace_file);
+        }
+        if (options.counters) {
+            Profiler::enable_counters(options.counter_list);
+        }
+
+        cout << "Filter type: " << filter_type << endl;
+        cout << "Filter size: " << filter->size << endl;
+        cout << "Levels: " << levels.name() << (levels.uniform() ? "" : " (rows, columns, depth)") << ", " << time_levels << " temporal" << endl;
+        cout << "Mode: 4D, " << frames << " frames of " << depth << "x" << rows << "x" << cols << endl;
+        cout << "Instruction set: " << isa_name(active_isa()) << " (detected " << isa_name(detect_isa()) << ")" << endl;
+        cout << "Threads: " << threads << endl;
+
+        MemoryReport memory;
+        DWTWorkspace workspace(depth, rows, cols, filter->size, threads);
+        SeriesDWT series(*filter, workspace);
+
+        auto reader = [&](const string& filename, const string& sample_type) {
+            return [&, filename, sample_type](size_t t, Array3D<float>& frame) {
+                frame.resize(depth, rows, cols, uninitialised);
+                IO::read_frame(filename, t, sample_type, frame);
+            };
+        };
+        auto writer = [](const string& filename) {
+            return [filename](size_t t, Array3DView<const float> frame) { IO::export_frame(frame, filename, t); };
+        };
+
+        // Transform the series into the output file
+        IO::create_series(output_filename, frames, depth * rows * cols);
+        double start_time = monotonic_time();
+        {
+            PROFILE_SCOPE("forward");
+            series.forward(frames, reader(binary_filename, dtype), writer(output_filename), levels, time_levels);
+        }
+        cout << "Time taken for 4D Wavelet Transform: " << monotonic_time() - start_time << " seconds\n" << endl;
+        cout << "Data exported to " << output_filename << " successfully.\n" << endl;
+        memory.mark("forward");
+
+        // Transform the coefficients back, reading them from the output file
+        string inverse_output_filename = "data/outputs/inverse_" + output_filename.substr(output_filename.find_last_of('/') + 1);
+        IO::create_series(inverse_output_filename, frames, depth * rows * cols);
+        start_time = monotonic_time();
+        {
+            PROFILE_SCOPE("inverse");
+            series.inverse(frames, reader(output_filename, "float32"), writer(inverse_output_filename), levels, time_levels);
+        }
+        cout << "Time taken for inverse 4D Wavelet Transform: " << monotonic_time() - start_time << " seconds" << endl;
+        cout << "Data exported to " << inverse_output_filename << " successfully." << endl;
+        memory.mark("inverse");
+
+        if (options.memory) {
+            cout << "\nMemory by stage:\n";
+            memory.print(cout);
+            cout << "Measured peak: " << format_mib(memory.peak()) << " (one frame is "
+                 << format_mib(depth * rows * cols * sizeof(float)) << ", the series " << format_mib(frames * depth * rows * cols * sizeof(float)) << ")\n" << endl;
+        }
+
+        Profiler::finish();
+
+    } catch (const runtime_error& e) {
+        cerr << "Runtime error: " << e.what() << endl;
+        return;
+    }
+}
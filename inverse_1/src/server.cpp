@@ -0,0 +1,295 @@
+#include "server.h"
+#include "denoise.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Largest volume accepted in one request (elements)
+const uint64_t MAX_VOXELS = uint64_t(1) << 32;
+
+// Longest output path accepted in one request (bytes)
+const uint32_t MAX_OUTPUT_LENGTH = 4096;
+
+// Set by SIGINT/SIGTERM to stop the accept loop
+volatile sig_atomic_t stop_requested = 0;
+
+void request_stop(int) {
+    stop_requested = 1;
+}
+
+/*
+ * Read exactly 'length' bytes from a socket
+ * Returns:
+ * - false if the peer closed the connection before the first byte (end of the requests)
+ * Throws if the connection ends part of the way through.
+ */
+bool read_exact(int fd, void* buffer, size_t length) {
+    char* p = static_cast<char*>(buffer);
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::read(fd, p + done, length - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n == 0 && done == 0) {
+                return false;
+            }
+            throw runtime_error(n == 0 ? "Connection closed in the middle of a request" : string("Error reading from socket: ") + strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Write exactly 'length' bytes to a socket
+void write_all(int fd, const void* buffer, size_t length) {
+    const char* p = static_cast<const char*>(buffer);
+    while (length > 0) {
+        ssize_t n = ::write(fd, p, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw runtime_error(string("Error writing to socket: ") + strerror(errno));
+        }
+        p += n;
+        length -= static_cast<size_t>(n);
+    }
+}
+
+// Send a response with an error message as its payload
+void send_error(int fd, const string& message) {
+    ResponseHeader response = {};
+    memcpy(response.magic, "DWTR", 4);
+    response.status = 1;
+    response.payload_bytes = message.size();
+    write_all(fd, &response, sizeof(response));
+    write_all(fd, message.data(), message.size());
+}
+
+// Length of the longest filter in the registry, to size the workspace line buffers once
+size_t longest_filter() {
+    size_t size = 0;
+    for (const string& name : filter_names()) {
+        size = max(size, find_filter(name)->size);
+    }
+    return size;
+}
+
+// Number of levels the largest dimension allows before every bound is down to one element
+uint32_t levels_allowed(uint64_t depth, uint64_t rows, uint64_t cols) {
+    uint32_t levels = 0;
+    for (uint64_t n = max(depth, max(rows, cols)); n > 1; n = (n + 1) / 2) {
+        ++levels;
+    }
+    return max<uint32_t>(levels, 1);
+}
+
+// Name of a job type, for the log
+const char* job_name(uint32_t job) {
+    switch (static_cast<JobType>(job)) {
+        case JobType::Transform: return "transform";
+        case JobType::Inverse: return "inverse";
+        case JobType::Denoise: return "denoise";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+Server::Server(const string& socket_path) : socket_path(socket_path), workspace(1, 1, 1, longest_filter()) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("Socket path is too long: " + socket_path);
+    }
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        throw runtime_error(string("Error creating socket: ") + strerror(errno));
+    }
+
+    // Replace the socket of a previous run that was not shut down cleanly, but never any other kind of file
+    struct stat existing;
+    if (lstat(socket_path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            close(listen_fd);
+            throw runtime_error(socket_path + " exists and is not a socket");
+        }
+        unlink(socket_path.c_str());
+    }
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_fd, 16) < 0) {
+        string error = strerror(errno);
+        close(listen_fd);
+        throw runtime_error("Error listening on " + socket_path + ": " + error);
+    }
+}
+
+Server::~Server() {
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+}
+
+// Accept and serve connections one at a time until SIGINT or SIGTERM
+void Server::run() {
+    // Interrupt accept() on SIGINT/SIGTERM (no SA_RESTART) and report closed peers as write errors
+    struct sigaction action = {};
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    cout << "Serving on " << socket_path << " with " << workspace.threads().size() << " threads, instruction set "
+         << isa_name(active_isa()) << endl;
+
+    while (!stop_requested) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error(string("Error accepting connection: ") + strerror(errno));
+        }
+        try {
+            serve_connection(fd);
+        } catch (const exception& e) {
+            // A broken connection only ends that client's session
+            cerr << "Connection error: " << e.what() << endl;
+        }
+        close(fd);
+    }
+    cout << "Server stopped" << endl;
+}
+
+/*
+ * Serve the requests of one connection
+ * Errors in a job (unknown filter, unwritable output path) are sent back and the
+ * connection stays open; a malformed request (bad dimensions, an output path over
+ * MAX_OUTPUT_LENGTH, levels the dimensions do not allow) closes the connection before
+ * anything is allocated for it.
+ * Parameters:
+ * - fd: the connected socket
+ */
+void Server::serve_connection(int fd) {
+    RequestHeader request;
+    while (!stop_requested && read_exact(fd, &request, sizeof(request))) {
+        if (memcmp(request.magic, "DWTQ", 4) != 0 || request.version != 1) {
+            send_error(fd, "Not a version 1 DWT request");
+            return;
+        }
+        if (request.depth == 0 || request.rows == 0 || request.cols == 0 || request.depth > MAX_VOXELS ||
+            request.rows > MAX_VOXELS / request.depth || request.cols > MAX_VOXELS / (request.depth * request.rows)) {
+            send_error(fd, "Invalid volume dimensions");
+            return;
+        }
+        if (request.output_length > MAX_OUTPUT_LENGTH) {
+            send_error(fd, "Output path is longer than " + to_string(MAX_OUTPUT_LENGTH) + " bytes");
+            return;
+        }
+        uint32_t allowed = levels_allowed(request.depth, request.rows, request.cols);
+        if (request.levels < 1 || request.levels > allowed) {
+            send_error(fd, "The number of levels must be from 1 to " + to_string(allowed) + " for this volume");
+            return;
+        }
+
+        // Output path, then the samples, read straight into the rows of the input volume
+        string output_path(request.output_length, '\0');
+        if (request.output_length > 0 && !read_exact(fd, &output_path[0], output_path.size())) {
+            throw runtime_error("Connection closed in the middle of a request");
+        }
+        input.resize(request.depth, request.rows, request.cols, uninitialised);
+        for (size_t d = 0; d < request.depth; ++d) {
+            for (size_t r = 0; r < request.rows; ++r) {
+                if (!read_exact(fd, &input(d, r, 0), request.cols * sizeof(float))) {
+                    throw runtime_error("Connection closed in the middle of a request");
+                }
+            }
+        }
+
+        double seconds;
+        try {
+            seconds = run_job(request);
+            if (!output_path.empty() && !IO::export_inverse(output, output_path)) {
+                throw runtime_error("Error writing " + output_path);
+            }
+        } catch (const exception& e) {
+            send_error(fd, e.what());
+            continue;
+        }
+
+        ResponseHeader response = {};
+        memcpy(response.magic, "DWTR", 4);
+        response.depth = output.get_depth();
+        response.rows = output.get_rows();
+        response.cols = output.get_cols();
+        response.payload_bytes = output_path.empty() ? output.size() * sizeof(float) : 0;
+        response.seconds = seconds;
+        write_all(fd, &response, sizeof(response));
+        if (output_path.empty()) {
+            for (size_t d = 0; d < output.get_depth(); ++d) {
+                for (size_t r = 0; r < output.get_rows(); ++r) {
+                    write_all(fd, &output(d, r, 0), output.get_cols() * sizeof(float));
+                }
+            }
+        }
+
+        cout << job_name(request.job) << " " << request.depth << "x" << request.rows << "x" << request.cols << " "
+             << string(request.filter, strnlen(request.filter, sizeof(request.filter))) << " " << request.levels
+             << " levels: " << seconds << " seconds" << endl;
+    }
+}
+
+/*
+ * Run the job of a request on the input volume, leaving the result in 'output'
+ * Parameters:
+ * - request: the header of the request
+ * Returns:
+ * - the time taken in seconds
+ */
+double Server::run_job(const RequestHeader& request) {
+    Wavelet& w = wavelet(string(request.filter, strnlen(request.filter, sizeof(request.filter))));
+    int levels = static_cast<int>(request.levels);
+    workspace.reserve(input.get_depth(), input.get_rows(), input.get_cols());
+
+    double start = monotonic_time();
+    switch (static_cast<JobType>(request.job)) {
+        case JobType::Transform:
+            w.dwt.dwt_3d(input, output, levels, workspace);
+            break;
+        case JobType::Inverse:
+            w.inverse.inverse_dwt_3d(input, output, levels, workspace);
+            break;
+        case JobType::Denoise:
+            output.resize(input.get_depth(), input.get_rows(), input.get_cols(), uninitialised);
+            Denoise::run(w.dwt, w.inverse, input.view(), output.view(), levels, request.threshold, workspace);
+            break;
+        default:
+            throw runtime_error("Unknown job type " + to_string(request.job));
+    }
+    return monotonic_time() - start;
+}
+
+// Get the transforms of a wavelet, creating them on its first request
+Server::Wavelet& Server::wavelet(const string& name) {
+    auto it = wavelets.find(name);
+    if (it != wavelets.end()) {
+        return *it->second;
+    }
+    const FilterInfo* filter = find_filter(name);
+    if (!filter) {
+        throw runtime_error("Unknown filter: " + name);
+    }
+    return *(wavelets[name] = make_unique<Wavelet>(*filter));
+}
@@ -0,0 +1,162 @@
+#include "stats.h"
+#include "utilities/profiler.h"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+/*
+ * Constructor to lay out the subbands of a transform (see subband_layout)
+ * Parameters:
+ * - depth, rows, cols: dimensions of the volume
+ * - levels: the levels of the transform along each axis
+ * - zero_threshold: magnitude at or below which a coefficient counts as zero
+ * - threads: the number of threads that add into the statistics
+ */
+SubbandStatistics::SubbandStatistics(size_t depth, size_t rows, size_t cols, const AxisLevels& levels, float zero_threshold, size_t threads)
+    : levels(levels), zero_threshold(zero_threshold) {
+    for (const SubbandLayout& layout : subband_layout(depth, rows, cols, levels)) {
+        SubbandStats stats;
+        stats.level = layout.level;
+        stats.tag = layout.tag;
+        copy(begin(layout.origin), end(layout.origin), stats.origin);
+        stats.depth = layout.depth;
+        stats.rows = layout.rows;
+        stats.cols = layout.cols;
+        bands.push_back(stats);
+    }
+    thread_stats.assign(max<size_t>(1, threads), bands);
+
+    // A band is final after the last level whose bounds reach into it: its own, unless an odd
+    // extent puts its first high slab inside the bounds of the deeper levels
+    vector<size_t> depth_levels, row_levels, col_levels;
+    level_bounds(depth, rows, cols, levels, depth_levels, row_levels, col_levels);
+    for (const SubbandStats& band : bands) {
+        int last = band.level;
+        for (int level = band.level + 1; level <= levels.max(); ++level) {
+            if (band.origin[0] < depth_levels[level-1] && band.origin[1] < row_levels[level-1] && band.origin[2] < col_levels[level-1]) {
+                last = level;
+            }
+        }
+        final_level.push_back(last);
+    }
+}
+
+/*
+ * Function to add the bands that become final once the passes of a level are done
+ * Each thread takes whole rows of a band and sums them into locals before adding
+ * them to its own accumulator, so the threads never write to shared memory.
+ * Parameters:
+ * - coefficients: the volume being transformed
+ * - level: the last level whose passes are done (from 1)
+ * - pool: the threads to share the rows between
+ */
+void SubbandStatistics::add_level(Array3DView<const float> coefficients, int level, ThreadPool& pool) {
+    PROFILE_SCOPE("statistics", level);
+    if (pool.size() > thread_stats.size()) {
+        throw runtime_error("The subband statistics were sized for fewer threads than the pool has");
+    }
+    const float threshold = zero_threshold;
+
+    for (size_t b = 0; b < bands.size(); ++b) {
+        const SubbandStats& band = bands[b];
+        if (final_level[b] != level) {
+            continue;
+        }
+        Array3DView<const float> data = coefficients.subview(band.origin[0], band.origin[1], band.origin[2], band.depth, band.rows, band.cols);
+        Profiler::add_work(sizeof(float) * data.size(), 4.0 * data.size());
+
+        pool.parallel_for(0, band.depth * band.rows, [&](size_t line, size_t thread_id) {
+            if (band.cols == 0) {
+                return;
+            }
+            SubbandStats& stats = thread_stats[thread_id][b];
+            const float* x = &data(line / band.rows, line % band.rows, 0);
+
+            double sum = 0.0, sum_squares = 0.0;
+            float low = x[0], high = x[0];
+            uint64_t zeros = 0;
+            for (size_t c = 0; c < band.cols; ++c) {
+                float value = x[c];
+                sum += value;
+                sum_squares += static_cast<double>(value) * value;
+                low = std::min(low, value);
+                high = std::max(high, value);
+                zeros += fabs(value) <= threshold;
+                ++stats.histogram[SubbandStats::bin(value)];
+            }
+
+            stats.min = stats.count == 0 ? low : std::min(stats.min, low);
+            stats.max = stats.count == 0 ? high : std::max(stats.max, high);
+            stats.count += band.cols;
+            stats.zeros += zeros;
+            stats.sum += sum;
+            stats.sum_squares += sum_squares;
+        });
+    }
+}
+
+/*
+ * Function to add every band of a finished transform
+ * Parameters:
+ * - coefficients: the transformed volume
+ * - pool: the threads to share the rows between
+ */
+void SubbandStatistics::add_all(Array3DView<const float> coefficients, ThreadPool& pool) {
+    for (int level = 1; level <= levels.max(); ++level) {
+        add_level(coefficients, level, pool);
+    }
+}
+
+/*
+ * Function to merge the accumulators of the threads
+ * Returns:
+ * - the statistics of every band, in the order of IO::export_subbands
+ */
+vector<SubbandStats> SubbandStatistics::merged() const {
+    vector<SubbandStats> result = bands;
+    for (const auto& stats : thread_stats) {
+        for (size_t b = 0; b < result.size(); ++b) {
+            result[b].merge(stats[b]);
+        }
+    }
+    return result;
+}
+
+/*
+ * Function to write the statistics as a JSON sidecar of the coefficients
+ * Each band has its level, tag, position and size, the energy (sum of squares), mean,
+ * variance, minimum, maximum, zero fraction and the counts of the magnitude histogram.
+ * Parameters:
+ * - filename: the name of the JSON file to write
+ */
+void SubbandStatistics::write_json(const string& filename) const {
+    ofstream file(filename);
+    if (!file) {
+        throw runtime_error("Error opening file for writing: " + filename);
+    }
+
+    vector<SubbandStats> result = merged();
+    file << setprecision(9);
+    file << "{\n  \"levels\": \"" << levels.name() << "\", \"zero_threshold\": " << zero_threshold
+         << ",\n  \"histogram\": {\"bins\": " << SubbandStats::HISTOGRAM_BINS << ", \"lowest_exponent\": " << SubbandStats::LOWEST_EXPONENT
+         << ", \"scale\": \"log2 magnitude\"},\n  \"subbands\": [\n";
+    for (size_t b = 0; b < result.size(); ++b) {
+        const SubbandStats& s = result[b];
+        file << "    {\"level\": " << s.level << ", \"tag\": \"" << s.tag << "\""
+             << ", \"origin\": [" << s.origin[0] << ", " << s.origin[1] << ", " << s.origin[2] << "]"
+             << ", \"shape\": [" << s.depth << ", " << s.rows << ", " << s.cols << "]"
+             << ", \"count\": " << s.count << ", \"energy\": " << s.sum_squares << ", \"mean\": " << s.mean()
+             << ", \"variance\": " << s.variance() << ", \"min\": " << s.min << ", \"max\": " << s.max
+             << ", \"zero_fraction\": " << s.zero_fraction() << ", \"histogram\": [";
+        for (size_t i = 0; i < SubbandStats::HISTOGRAM_BINS; ++i) {
+            file << (i ? ", " : "") << s.histogram[i];
+        }
+        file << "]}" << (b + 1 < result.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+
+    if (!file) {
+        throw runtime_error("Error writing statistics to file: " + filename);
+    }
+}
@@ -0,0 +1,185 @@
+#include "sweep.h"
+#include "denoise.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+/*
+ * Measure the energy compaction and sparsity of a transformed volume
+ * Parameters:
+ * - coefficients: the transformed volume
+ * - levels: number of levels of decomposition
+ * - threshold: magnitude below which a detail coefficient counts as zero
+ * - result: receives lll_energy and sparsity
+ */
+void coefficient_statistics(Array3DView<const float> coefficients, int levels, float threshold, SweepResult& result) {
+    // The LLL band of the deepest level, the first of the subband layout
+    SubbandLayout band = subband_layout(coefficients.get_depth(), coefficients.get_rows(), coefficients.get_cols(), levels).front();
+    size_t lll_depth = band.depth, lll_rows = band.rows, lll_cols = band.cols;
+
+    double total = 0.0, lll = 0.0;
+    size_t details = 0, small = 0;
+    for (size_t d = 0; d < coefficients.get_depth(); ++d) {
+        for (size_t r = 0; r < coefficients.get_rows(); ++r) {
+            for (size_t c = 0; c < coefficients.get_cols(); ++c) {
+                double value = coefficients(d, r, c);
+                total += value * value;
+                if (d < lll_depth && r < lll_rows && c < lll_cols) {
+                    lll += value * value;
+                } else {
+                    ++details;
+                    small += fabs(value) < threshold;
+                }
+            }
+        }
+    }
+    result.lll_energy = total > 0.0 ? lll / total : 0.0;
+    result.sparsity = details > 0 ? static_cast<double>(small) / details : 0.0;
+}
+
+// Measure the largest and the root mean square difference between two volumes
+void round_trip_error(Array3DView<const float> original, Array3DView<const float> reconstructed, SweepResult& result) {
+    double max_error = 0.0, sum = 0.0;
+    for (size_t d = 0; d < original.get_depth(); ++d) {
+        for (size_t r = 0; r < original.get_rows(); ++r) {
+            for (size_t c = 0; c < original.get_cols(); ++c) {
+                double error = fabs(static_cast<double>(original(d, r, c)) - reconstructed(d, r, c));
+                max_error = max(max_error, error);
+                sum += error * error;
+            }
+        }
+    }
+    result.max_error = max_error;
+    result.rms_error = sqrt(sum / max<size_t>(1, original.size()));
+}
+
+// Write the results as CSV, one row per combination
+void write_csv(const string& filename, const vector<SweepResult>& results, float threshold) {
+    ofstream file(filename);
+    if (!file) {
+        throw runtime_error("Error opening file for writing: " + filename);
+    }
+    file << setprecision(9) << "filter,levels,forward_seconds,inverse_seconds,lll_energy,threshold,sparsity,max_error,rms_error\n";
+    for (const SweepResult& r : results) {
+        file << r.filter << "," << r.levels << "," << r.forward_seconds << "," << r.inverse_seconds << "," << r.lll_energy << ","
+             << threshold << "," << r.sparsity << "," << r.max_error << "," << r.rms_error << "\n";
+    }
+}
+
+} // namespace
+
+/*
+ * Sweep the combinations of filter and levels on one volume
+ * Each combination needs its own coefficients, reconstruction and workspace, so as many
+ * run at once as fit in the available memory (and the threads are shared between them);
+ * run times of concurrent combinations include their contention for memory bandwidth.
+ * Parameters:
+ * - binary_filename, shape_filename: the input volume (or options.dicom_directory)
+ * - filters: names of the filters to try (an alias of one already given is skipped)
+ * - levels: numbers of levels to try
+ * - options: input options, plus the sparsity threshold and the CSV file of the results
+ */
+void perform_sweep(const string& binary_filename, const string& shape_filename, const vector<string>& filters,
+                   const vector<int>& levels, const TransformOptions& options) {
+    // Check every combination before reading anything, trying each filter bank once
+    // (the registry has aliases, e.g. haar and db1, and a list may repeat a filter)
+    vector<pair<const FilterInfo*, int>> combinations;
+    vector<const float*> banks;
+    for (const string& name : filters) {
+        const FilterInfo* filter = find_filter(name);
+        if (!filter) {
+            throw runtime_error("Unknown filter: " + name);
+        }
+        if (find(banks.begin(), banks.end(), filter->lpf) != banks.end()) {
+            continue;
+        }
+        banks.push_back(filter->lpf);
+        for (int level : levels) {
+            if (level < 1) {
+                throw runtime_error("The number of levels must be at least 1");
+            }
+            combinations.push_back({filter, level});
+        }
+    }
+    if (!options.isa.empty()) {
+        set_isa(options.isa);
+    }
+
+    Array3D<float> volume = options.dicom_directory.empty() ? IO::read(binary_filename, shape_filename, options.dtype) : DICOM::read_series(options.dicom_directory);
+    size_t depth = volume.get_depth(), rows = volume.get_rows(), cols = volume.get_cols();
+
+    // The same threshold for every combination: the one given, or the universal threshold of a one-level Haar transform
+    float threshold = options.threshold;
+    if (threshold < 0.0f) {
+        const FilterInfo* haar = find_filter("haar");
+        DWT dwt(haar->lpf, haar->hpf, haar->size);
+        Array3D<float> coefficients;
+        DWTWorkspace workspace(depth, rows, cols, haar->size);
+        dwt.dwt_3d(volume, coefficients, 1, workspace);
+        threshold = Denoise::universal_threshold(coefficients.view());
+    }
+
+    // Run as many combinations at once as there are threads and memory for
+    size_t longest = 0;
+    for (const auto& combination : combinations) {
+        longest = max(longest, combination.first->size);
+    }
+    size_t jobs = min(combinations.size(), thread_count());
+    size_t available = available_memory();
+    while (jobs > 1 && available > 0) {
+        size_t threads = max<size_t>(1, thread_count() / jobs);
+        size_t per_job = 2 * Array3D<float>::storage_size(depth, rows, cols) * sizeof(float) +
+                         DWTWorkspace::storage_bytes(depth, rows, cols, longest, threads);
+        if (jobs * per_job <= available / 10 * 8) {
+            break;
+        }
+        --jobs;
+    }
+    size_t threads = max<size_t>(1, thread_count() / jobs);
+
+    cout << "Sweeping " << combinations.size() << " combinations on " << depth << "x" << rows << "x" << cols << ", "
+         << jobs << " at a time with " << threads << " threads each, sparsity threshold " << threshold << "\n" << endl;
+
+    vector<SweepResult> results(combinations.size());
+    parallel_for(0, combinations.size(), [&](size_t i, size_t) {
+        const FilterInfo& filter = *combinations[i].first;
+        int level = combinations[i].second;
+        DWT dwt(filter.lpf, filter.hpf, filter.size);
+        Inverse inverse(filter.Ilpf, filter.Ihpf, filter.size);
+        DWTWorkspace workspace(depth, rows, cols, filter.size, threads);
+        Array3D<float> coefficients, reconstructed;
+
+        SweepResult& result = results[i];
+        result.filter = filter.name;
+        result.levels = level;
+
+        double start = monotonic_time();
+        dwt.dwt_3d(volume, coefficients, level, workspace);
+        result.forward_seconds = monotonic_time() - start;
+
+        start = monotonic_time();
+        inverse.inverse_dwt_3d(coefficients, reconstructed, level, workspace);
+        result.inverse_seconds = monotonic_time() - start;
+
+        coefficient_statistics(coefficients.view(), level, threshold, result);
+        round_trip_error(volume.view(), reconstructed.view(), result);
+    }, jobs);
+
+    cout << left << setw(10) << "Filter" << right << setw(8) << "Levels" << setw(14) << "Forward (ms)" << setw(14) << "Inverse (ms)"
+         << setw(12) << "LLL energy" << setw(12) << "Sparsity" << setw(14) << "Max error" << setw(14) << "RMS error" << "\n";
+    for (const SweepResult& r : results) {
+        cout << left << setw(10) << r.filter << right << setw(8) << r.levels << fixed << setprecision(3)
+             << setw(14) << r.forward_seconds * 1e3 << setw(14) << r.inverse_seconds * 1e3
+             << setprecision(2) << setw(11) << r.lll_energy * 100 << "%" << setw(11) << r.sparsity * 100 << "%"
+             << scientific << setprecision(3) << setw(14) << r.max_error << setw(14) << r.rms_error << defaultfloat << "\n";
+    }
+    cout << endl;
+
+    if (!options.sweep_file.empty()) {
+        write_csv(options.sweep_file, results, threshold);
+        cout << "Sweep results written to " << options.sweep_file << endl;
+    }
+}
@@ -0,0 +1,304 @@
+#include "DWT.h"
+#include "tuning.h"
+
+/* 
+ * Perform the 3D Discrete Wavelet Transform on the input data and export the result
+ * Parameters:
+ * - binary_filename: the name of the binary file containing the input data
+ * - output_filename: the name of the binary file to write the transformed data to
+ * - filter_type: the type of wavelet filter to use (e.g., "haar", "db1")
+ * - levels: the number of levels of decomposition (one number, or one per axis)
+ * - options: optional settings (e.g. reading from a DICOM series)
+ */
+void perform_transform(const string& binary_filename, const string& output_filename, const string& filter_type, const AxisLevels& levels, const TransformOptions& requested) {
+    // The settings not given are filled in once the dimensions are known
+    TransformOptions options = requested;
+
+    // Choose the wavelet filters based on user input
+    const float* lpf;
+    const float* hpf;
+    const float* Ilpf;
+    const float* Ihpf;
+    size_t filter_size;
+    
+    // Determine the shape file based on the binary file name
+    string shape_filename = binary_filename.substr(0, binary_filename.find_last_of('.')) + "_shape.txt";
+
+    if (!get_filters(filter_type, lpf, hpf, Ilpf, Ihpf, filter_size)) {
+        cerr << "Failed to get filters for type: " << filter_type << endl;
+        return;
+    }
+
+    // Measure the bandwidth roof before profiling starts, so the probe does not appear in the trace
+    if (options.roofline) {
+        double peak = measure_bandwidth();
+        cout << "Peak memory bandwidth (triad, " << thread_count() << " threads): " << peak << " GB/s" << endl;
+        Profiler::set_peak_bandwidth(peak);
+    }
+
+    // Record the time (and counters) of each stage if requested (DWT_TRACE and DWT_COUNTERS also enable this)
+    if (options.profile || options.counters || options.roofline) {
+        Profiler::enable(options.trace_file);
+    }
+    if (options.counters) {
+        Profiler::enable_counters(options.counter_list);
+    }
+
+    try {
+        // Images are always decomposed channel by channel; 2D transforms take one number of levels
+        bool slices = options.slices_2d || !options.image_file.empty();
+        if (slices && !levels.uniform()) {
+            throw runtime_error("The 2D transform takes one number of levels, not one per axis");
+        }
+        if (slices && (options.autotune || (!options.layout.empty() && options.layout != "linear"))) {
+            throw runtime_error("The 2D transform uses the linear layout and cannot be autotuned");
+        }
+
+        // Predict the peak memory from the shape file alone
+        if (options.dry_run) {
+            if (!options.dicom_directory.empty() || !options.image_file.empty()) {
+                throw runtime_error("A dry run needs the shape file of a binary input, not a DICOM series or image");
+            }
+            string dtype;
+            vector<size_t> shape = IO::read_shape(shape_filename, dtype);
+            if (shape.size() != 3) {
+                throw runtime_error("Invalid shape information");
+            }
+            apply_tuning(options, shape[0], shape[1], shape[2]);
+            MemoryEstimate estimate = estimate_memory(shape[0], shape[1], shape[2], filter_size, options.layout, options.threads);
+
+            cout << "Dry run: " << shape[0] << "x" << shape[1] << "x" << shape[2] << ", filter " << filter_type << " (" << filter_size
+                 << " taps), " << levels.name() << " levels, " << options.layout << " layout, " << options.threads << " threads" << endl;
+            for (const auto& buffer : estimate.buffers) {
+                cout << "  " << left << setw(32) << buffer.first << right << setw(16) << format_mib(buffer.second) << endl;
+            }
+            cout << "Predicted peak memory: " << format_mib(estimate.peak) << " (" << estimate.peak << " bytes)" << endl;
+            return;
+        }
+        MemoryReport memory;
+
+        // Read the DICOM data into an array, either from the series or from the converted binary file
+        // (or an image, with one slice per channel)
+        const string& input_name = !options.image_file.empty() ? options.image_file : (options.dicom_directory.empty() ? binary_filename : options.dicom_directory);
+        int maxval = 0;
+        Array3D<float> dicom_data = !options.image_file.empty() ? IO::read_image(options.image_file, maxval)
+                                  : options.dicom_directory.empty() ? IO::read(binary_filename, shape_filename, options.dtype) : DICOM::read_series(options.dicom_directory);
+
+        cout << "\nData read from " << input_name << " successfully.\n" << endl;
+        memory.mark("read");
+
+        // Print the characteristics of the input data
+        cout << "Filter type: " << filter_type << endl;
+        cout << "Filter size: " << filter_size << endl;
+        cout << "Levels: " << levels.name() << (levels.uniform() ? "" : " (rows, columns, depth)") << endl;
+        if (slices) {
+            cout << "Mode: 2D, " << dicom_data.get_depth() << " slices of " << dicom_data.get_rows() << "x" << dicom_data.get_cols() << endl;
+        }
+
+        // A 2D transform is a 3D one with no levels along the depth, for the exports
+        AxisLevels schedule = slices ? AxisLevels(levels.rows, levels.cols, 0) : levels;
+
+        // Check the layout given before timing any candidates
+        if (!options.layout.empty() && options.layout != "linear" && options.layout != "compact" && options.layout != "tiled" && options.layout != "tiled-linear") {
+            throw runtime_error("Unknown layout: " + options.layout);
+        }
+
+        // Tune the passes for this machine and volume shape, or use the stored settings
+        if (options.autotune) {
+            TuningConfig best = autotune(dicom_data, *find_filter(filter_type), levels, options);
+            TuningDB db;
+            db.store(cpu_model(), shape_class(dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols()), best);
+            db.save();
+            cout << "Fastest: " << best.layout << " layout, " << best.isa << ", " << best.threads << " threads ("
+                 << best.seconds * 1e3 << " ms), saved to " << db.get_path() << "\n" << endl;
+            options.layout = best.layout;
+            options.isa = best.isa;
+            options.threads = best.threads;
+        }
+        apply_tuning(options, dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols());
+        if (slices) {
+            options.layout = "linear";
+        }
+
+        // Choose the instruction set of the kernels before they are selected by the DWT and Inverse objects
+        if (!options.isa.empty()) {
+            set_isa(options.isa);
+        }
+        cout << "Instruction set: " << isa_name(active_isa()) << " (detected " << isa_name(detect_isa()) << ")" << endl;
+        cout << "Threads: " << options.threads << endl;
+
+        // Create a DWT object to store filter information
+        DWT dwt(lpf, hpf, filter_size);
+
+        // Create the workspace shared by the forward and inverse transforms
+        DWTWorkspace workspace(dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols(), filter_size, options.threads);
+
+        // The memory layout, checked above or read from the tuning database (which only keeps known ones)
+        bool tiled = options.layout == "tiled" || options.layout == "tiled-linear";
+        bool compact = options.layout == "compact";
+        TileOrder order = options.layout == "tiled" ? TileOrder::Morton : TileOrder::Linear;
+
+        Array3D<float> wavelet_3d;
+        double elapsed_time;
+
+        // Statistics of each subband, gathered by the linear transform level by level
+        unique_ptr<SubbandStatistics> statistics;
+        if (options.stats) {
+            statistics = make_unique<SubbandStatistics>(dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols(),
+                                                        schedule, max(options.threshold, 0.0f), workspace.threads().size());
+        }
+
+        if (tiled) {
+            // Convert to the tiled layout outside of the timed region
+            TiledArray3D<float> tiled_data(dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols(), order);
+            tiled_data.assign(dicom_data);
+
+            double start_time = monotonic_time();
+            {
+                PROFILE_SCOPE("forward");
+                dwt.dwt_3d(tiled_data, levels, &workspace);
+            }
+            elapsed_time = monotonic_time() - start_time;
+
+            wavelet_3d = Array3D<float>(dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols(), uninitialised);
+            tiled_data.extract(wavelet_3d);
+        } else {
+            // Measure the time taken for the 3D wavelet transform
+            double start_time = monotonic_time();
+
+            // Perform the 3D wavelet transform with the desired number of levels
+            {
+                PROFILE_SCOPE("forward");
+                if (slices) {
+                    wavelet_3d.resize(dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols(), uninitialised);
+                    dwt.dwt_2d(dicom_data, wavelet_3d, levels.rows, workspace);
+                } else if (compact) {
+                    wavelet_3d.resize(dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols(), uninitialised);
+                    dwt.dwt_3d_compact(dicom_data, wavelet_3d, levels, workspace);
+                } else {
+                    dwt.dwt_3d(dicom_data, wavelet_3d, levels, workspace, statistics.get());
+                }
+            }
+
+            double end_time = monotonic_time();
+            elapsed_time = end_time - start_time;
+        }
+
+        cout << "Time taken for 3D Wavelet Transform (" << options.layout << " layout): " << elapsed_time << " seconds\n" << endl;
+        memory.mark("forward");
+
+        // Export the transformed data to a binary file
+        IO::export_data(wavelet_3d, output_filename);
+
+        cout << "Data exported to " << output_filename << " successfully.\n" << endl;
+
+        // Export every subband of every level with an index for partial reads
+        string subbands_filename = output_filename.substr(0, output_filename.find_last_of('.')) + "_subbands.bin";
+        IO::export_subbands(wavelet_3d, subbands_filename, schedule);
+
+        cout << "Subbands exported to " << subbands_filename << " successfully.\n" << endl;
+
+        // Write the subband statistics (the other layouts add them from the coefficients in memory)
+        if (statistics) {
+            if (tiled || compact || slices) {
+                statistics->add_all(wavelet_3d, workspace.threads());
+            }
+            string stats_filename = output_filename.substr(0, output_filename.find_last_of('.')) + "_stats.json";
+            statistics->write_json(stats_filename);
+            cout << "Subband statistics exported to " << stats_filename << " successfully.\n" << endl;
+        }
+        memory.mark("export");
+
+        // Create an Inverse object to store filter information
+        Inverse inverse(Ilpf, Ihpf, filter_size);
+
+        // Perform the inverse 3D wavelet transform
+        Array3D<float> reconstructed_data;
+        if (tiled) {
+            TiledArray3D<float> tiled_data(wavelet_3d.get_depth(), wavelet_3d.get_rows(), wavelet_3d.get_cols(), order);
+            tiled_data.assign(wavelet_3d);
+            PROFILE_SCOPE("inverse");
+            inverse.inverse_dwt_3d(tiled_data, levels, &workspace);
+            reconstructed_data = Array3D<float>(wavelet_3d.get_depth(), wavelet_3d.get_rows(), wavelet_3d.get_cols(), uninitialised);
+            tiled_data.extract(reconstructed_data);
+        } else if (slices) {
+            PROFILE_SCOPE("inverse");
+            reconstructed_data.resize(wavelet_3d.get_depth(), wavelet_3d.get_rows(), wavelet_3d.get_cols(), uninitialised);
+            inverse.inverse_dwt_2d(wavelet_3d, reconstructed_data, levels.rows, workspace);
+        } else if (compact) {
+            PROFILE_SCOPE("inverse");
+            reconstructed_data.resize(wavelet_3d.get_depth(), wavelet_3d.get_rows(), wavelet_3d.get_cols(), uninitialised);
+            inverse.inverse_dwt_3d_compact(wavelet_3d, reconstructed_data, levels, workspace);
+        } else {
+            PROFILE_SCOPE("inverse");
+            inverse.inverse_dwt_3d(wavelet_3d, reconstructed_data, levels, workspace);
+        }
+
+        memory.mark("inverse");
+
+        // Determine the inverse output filename
+        std::string inverse_output_filename = "data/outputs/inverse_" + output_filename.substr(output_filename.find_last_of('/') + 1);
+    
+        // Export the reconstructed data to a binary file
+        IO::export_inverse(reconstructed_data, inverse_output_filename);
+
+        cout << "Inverse 3D Wavelet Transform completed successfully." << endl;
+        cout << "Data exported to " << inverse_output_filename << " successfully." << endl;
+
+        // Write the reconstruction of an image back as an image
+        if (!options.image_file.empty()) {
+            string image_filename = inverse_output_filename.substr(0, inverse_output_filename.find_last_of('.')) + (reconstructed_data.get_depth() == 3 ? ".ppm" : ".pgm");
+            IO::export_image(reconstructed_data, image_filename, maxval);
+            cout << "Image exported to " << image_filename << " successfully." << endl;
+        }
+        memory.mark("export_inverse");
+
+        if (options.memory) {
+            MemoryEstimate estimate = estimate_memory(dicom_data.get_depth(), dicom_data.get_rows(), dicom_data.get_cols(), filter_size, options.layout, options.threads);
+            cout << "\nMemory by stage:\n";
+            memory.print(cout);
+            cout << "Predicted peak: " << format_mib(estimate.peak) << ", measured peak: " << format_mib(memory.peak()) << "\n" << endl;
+        }
+
+        // Print the time of each stage and write the trace, if profiling
+        Profiler::finish();
+
+    } catch (const runtime_error& e) {
+        cerr << "Runtime error: " << e.what() << endl;
+        return;
+    }
+}
+
+/*
+ * Predict the allocations of perform_transform, without allocating anything
+ * The transform works in place, so the number of levels does not change the peak: it is
+ * reached in the inverse stage, when the input, workspace, coefficients and reconstruction
+ * (and, for the tiled layouts, the tiled copy) are all held at once.
+ * Parameters:
+ * - depth, rows, cols: dimensions of the volume
+ * - filter_size: number of filter taps (sizes the line buffers)
+ * - layout: linear, compact, tiled or tiled-linear (the compact level buffers are counted for
+ *   as many levels as the volume allows)
+ * - threads: number of worker threads (one line buffer each)
+ * Returns:
+ * - the size of each large buffer and the predicted peak
+ */
+MemoryEstimate estimate_memory(size_t depth, size_t rows, size_t cols, size_t filter_size, const string& layout, size_t threads) {
+    size_t volume = Array3D<float>::storage_size(depth, rows, cols) * sizeof(float);
+
+    MemoryEstimate estimate;
+    estimate.buffers.push_back({"input volume", volume});
+    estimate.buffers.push_back({"workspace (scratch and lines)", DWTWorkspace::storage_bytes(depth, rows, cols, filter_size, threads)});
+    if (layout == "compact") {
+        estimate.buffers.push_back({"compact level buffers", DWTWorkspace::compact_bytes(depth, rows, cols)});
+    } else if (layout != "linear") {
+        estimate.buffers.push_back({"tiled copy", TiledArray3D<float>::storage_size(depth, rows, cols) * sizeof(float)});
+    }
+    estimate.buffers.push_back({"coefficients", volume});
+    estimate.buffers.push_back({"reconstruction", volume});
+
+    for (const auto& buffer : estimate.buffers) {
+        estimate.peak += buffer.second;
+    }
+    return estimate;
+}
@@ -0,0 +1,273 @@
+#include "tuning.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+// Get the model name of the CPU (from /proc/cpuinfo), or "unknown"
+string cpu_model() {
+    ifstream file("/proc/cpuinfo");
+    string line;
+    while (getline(file, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            string model = line.substr(line.find(':') + 1);
+            model.erase(0, model.find_first_not_of(" \t"));
+            // Tabs separate the fields of the database
+            replace(model.begin(), model.end(), '\t', ' ');
+            return model;
+        }
+    }
+    return "unknown";
+}
+
+// Get the shape class of a volume: each dimension rounded up to a power of two
+string shape_class(size_t depth, size_t rows, size_t cols) {
+    auto round_up = [](size_t n) {
+        size_t p = 1;
+        while (p < n) {
+            p *= 2;
+        }
+        return p;
+    };
+    return to_string(round_up(depth)) + "x" + to_string(round_up(rows)) + "x" + to_string(round_up(cols));
+}
+
+// Parse one line of the database into its key and settings; false if the line is malformed
+static bool parse_entry(const string& line, pair<string, string>& key, TuningConfig& config) {
+    vector<string> fields;
+    stringstream ss(line);
+    string field;
+    while (getline(ss, field, '\t')) {
+        fields.push_back(field);
+    }
+    if (fields.size() != 6) {
+        return false;
+    }
+    static const vector<string> layouts = {"linear", "compact", "tiled", "tiled-linear"};
+    static const vector<string> isas = {"auto", "sse2", "avx2", "avx512"};
+    if (find(layouts.begin(), layouts.end(), fields[2]) == layouts.end() || find(isas.begin(), isas.end(), fields[3]) == isas.end()) {
+        return false;
+    }
+    try {
+        size_t threads_end = 0, seconds_end = 0;
+        config.threads = stoul(fields[4], &threads_end);
+        config.seconds = stod(fields[5], &seconds_end);
+        if (threads_end != fields[4].size() || seconds_end != fields[5].size() || config.threads == 0) {
+            return false;
+        }
+    } catch (const logic_error&) { // invalid_argument or out_of_range
+        return false;
+    }
+    config.layout = fields[2];
+    config.isa = fields[3];
+    key = {fields[0], fields[1]};
+    return true;
+}
+
+// Load the database; each line is: cpu, shape class, layout, isa, threads, seconds (tab separated).
+// A malformed line is skipped with a warning, so a damaged file never stops a transform.
+TuningDB::TuningDB(const string& path) : path(path) {
+    ifstream file(path);
+    string line;
+    for (size_t number = 1; getline(file, line); ++number) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        pair<string, string> key;
+        TuningConfig config;
+        if (!parse_entry(line, key, config)) {
+            cerr << "Warning: skipping malformed line " << number << " of tuning database " << path << endl;
+            continue;
+        }
+        entries[key] = config;
+    }
+}
+
+// Get the default location of the database: DWT_TUNING_DB, or ~/.cache/dwt/tuning.tsv
+string TuningDB::default_path() {
+    if (const char* env = getenv("DWT_TUNING_DB")) {
+        return env;
+    }
+    if (const char* cache = getenv("XDG_CACHE_HOME")) {
+        return string(cache) + "/dwt/tuning.tsv";
+    }
+    if (const char* home = getenv("HOME")) {
+        return string(home) + "/.cache/dwt/tuning.tsv";
+    }
+    return ".dwt_tuning.tsv";
+}
+
+bool TuningDB::lookup(const string& cpu, const string& shape, TuningConfig& config) const {
+    auto it = entries.find({cpu, shape});
+    if (it == entries.end()) {
+        return false;
+    }
+    config = it->second;
+    return true;
+}
+
+void TuningDB::store(const string& cpu, const string& shape, const TuningConfig& config) {
+    entries[{cpu, shape}] = config;
+}
+
+void TuningDB::save() const {
+    filesystem::path file_path(path);
+    if (file_path.has_parent_path()) {
+        filesystem::create_directories(file_path.parent_path());
+    }
+    ofstream file(path);
+    if (!file) {
+        throw runtime_error("Error opening tuning database for writing: " + path);
+    }
+    file << "# cpu\tshape\tlayout\tisa\tthreads\tseconds\n" << setprecision(9);
+    for (const auto& entry : entries) {
+        const TuningConfig& config = entry.second;
+        file << entry.first.first << "\t" << entry.first.second << "\t" << config.layout << "\t" << config.isa << "\t"
+             << config.threads << "\t" << config.seconds << "\n";
+    }
+}
+
+/*
+ * Time the forward and inverse transforms of a volume with the given settings
+ * Parameters:
+ * - volume: the volume to transform
+ * - filter: the wavelet
+ * - levels: number of levels of decomposition (along each axis)
+ * - config: the layout, instruction set and thread count to use
+ * Returns:
+ * - the median time of three runs (after a warm-up run), in seconds
+ */
+static double time_config(const Array3D<float>& volume, const FilterInfo& filter, const AxisLevels& levels, const TuningConfig& config) {
+    // The kernels are chosen when the transforms are created
+    set_isa(config.isa);
+    DWT dwt(filter.lpf, filter.hpf, filter.size);
+    Inverse inverse(filter.Ilpf, filter.Ihpf, filter.size);
+    DWTWorkspace workspace(volume.get_depth(), volume.get_rows(), volume.get_cols(), filter.size, config.threads);
+
+    Array3D<float> coefficients, reconstructed;
+    unique_ptr<TiledArray3D<float>> tiled;
+    if (config.layout == "compact") {
+        coefficients.resize(volume.get_depth(), volume.get_rows(), volume.get_cols(), uninitialised);
+        reconstructed.resize(volume.get_depth(), volume.get_rows(), volume.get_cols(), uninitialised);
+    } else if (config.layout != "linear") {
+        tiled = make_unique<TiledArray3D<float>>(volume.get_depth(), volume.get_rows(), volume.get_cols(),
+                                                 config.layout == "tiled" ? TileOrder::Morton : TileOrder::Linear);
+    }
+
+    vector<double> times;
+    for (int run = 0; run < 4; ++run) {
+        double seconds;
+        if (config.layout == "compact") {
+            double start = monotonic_time();
+            dwt.dwt_3d_compact(volume, coefficients, levels, workspace);
+            inverse.inverse_dwt_3d_compact(coefficients, reconstructed, levels, workspace);
+            seconds = monotonic_time() - start;
+        } else if (!tiled) {
+            double start = monotonic_time();
+            dwt.dwt_3d(volume, coefficients, levels, workspace);
+            inverse.inverse_dwt_3d(coefficients, reconstructed, levels, workspace);
+            seconds = monotonic_time() - start;
+        } else {
+            // Conversion to and from the tiled layout is not timed, as in perform_transform
+            tiled->assign(volume);
+            double start = monotonic_time();
+            dwt.dwt_3d(*tiled, levels, &workspace);
+            inverse.inverse_dwt_3d(*tiled, levels, &workspace);
+            seconds = monotonic_time() - start;
+        }
+        // The first run is a warm-up
+        if (run > 0) {
+            times.push_back(seconds);
+        }
+    }
+    sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+/*
+ * Find the fastest settings of the passes for a volume on this machine
+ * Every combination of layout, instruction set (those the CPU supports) and thread
+ * count (powers of two up to the available threads, and the available threads) is
+ * timed, except for the settings fixed in the options.
+ * Parameters:
+ * - volume: the volume to tune for
+ * - filter: the wavelet
+ * - levels: number of levels of decomposition (along each axis)
+ * - options: settings given on the command line, which are not tuned
+ * Returns:
+ * - the fastest settings and their time
+ */
+TuningConfig autotune(const Array3D<float>& volume, const FilterInfo& filter, const AxisLevels& levels, const TransformOptions& options) {
+    vector<string> layouts = {"linear", "compact", "tiled", "tiled-linear"};
+    if (!options.layout.empty()) {
+        layouts = {options.layout};
+    }
+
+    vector<string> isas;
+    if (!options.isa.empty() && options.isa != "auto") {
+        isas = {options.isa};
+    } else {
+        for (ISA isa : {ISA::SSE2, ISA::AVX2, ISA::AVX512}) {
+            if (static_cast<int>(isa) <= static_cast<int>(detect_isa())) {
+                isas.push_back(isa_name(isa));
+            }
+        }
+    }
+
+    vector<size_t> thread_counts;
+    if (options.threads > 0) {
+        thread_counts = {options.threads};
+    } else {
+        for (size_t n = 1; n < thread_count(); n *= 2) {
+            thread_counts.push_back(n);
+        }
+        thread_counts.push_back(thread_count());
+    }
+
+    cout << "Autotuning " << layouts.size() * isas.size() * thread_counts.size() << " configurations for "
+         << shape_class(volume.get_depth(), volume.get_rows(), volume.get_cols()) << " on " << cpu_model() << endl;
+
+    TuningConfig best;
+    for (const string& layout : layouts) {
+        for (const string& isa : isas) {
+            for (size_t threads : thread_counts) {
+                TuningConfig config;
+                config.layout = layout;
+                config.isa = isa;
+                config.threads = threads;
+                config.seconds = time_config(volume, filter, levels, config);
+                cout << "  " << left << setw(14) << layout << setw(8) << isa << right << setw(4) << threads << " threads: "
+                     << config.seconds * 1e3 << " ms" << endl;
+                if (best.threads == 0 || config.seconds < best.seconds) {
+                    best = config;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+// Fill in the layout, instruction set and thread count not given from the tuning database
+void apply_tuning(TransformOptions& options, size_t depth, size_t rows, size_t cols) {
+    TuningConfig config;
+    if (options.use_tuning) {
+        TuningDB db;
+        if (db.lookup(cpu_model(), shape_class(depth, rows, cols), config)) {
+            cout << "Tuned settings from " << db.get_path() << ": " << config.layout << " layout, " << config.isa << ", "
+                 << config.threads << " threads" << endl;
+        }
+    }
+
+    if (options.layout.empty()) {
+        options.layout = config.layout.empty() ? "linear" : config.layout;
+    }
+    if (options.isa.empty()) {
+        options.isa = config.isa;
+    }
+    if (options.threads == 0) {
+        options.threads = config.threads > 0 ? config.threads : thread_count();
+    }
+}
@@ -65,16 +65,16 @@ void precompute_lanczos(jbutil::vector<real>& lanczos_values, int a, int R) {
     }
 }
 
-// Inline lanczos function
+// Inline lanczos function (always inlined, so it is compiled for the instruction set of the caller)
 template <class real>
-inline real lanczos(const jbutil::vector<real>& lanczos_values, real x, int a, int R) {
+__attribute__((always_inline)) inline real lanczos(const jbutil::vector<real>& lanczos_values, real x, int a, int R) {
     int index = min(static_cast<int>(x * R), a * R);
     return lanczos_values[index];
 }
 
 // Convolution function with vectorization
 template <class real>
-real convolve(const jbutil::image<int>& image, real m, real n, int a, real R, const jbutil::vector<real>& lanczos_values) {
+__attribute__((always_inline)) inline real convolve(const jbutil::image<int>& image, real m, real n, int a, real R, const jbutil::vector<real>& lanczos_values) {
     int m_start = max(0, static_cast<int>(ceil(m / R - a)));
     int m_end = min(image.get_cols() - 1, static_cast<int>(floor(m / R + a)));
     int n_start = max(0, static_cast<int>(ceil(n / R - a)));
@@ -124,8 +124,9 @@ real convolve(const jbutil::image<int>& image, real m, real n, int a, real R, co
 }
 
 // Compute the convolution for each destination image pixel
+// (always inlined into one of the resample_* variants below)
 template <class real>
-void resample_image_chunk(const ResampleParams<real>& params) {
+__attribute__((always_inline)) inline void resample_image_chunk(const ResampleParams<real>& params) {
     int new_height = params.image_out.get_rows();
 
     for (int i = params.start_col; i < params.end_col; ++i) {
@@ -138,7 +139,9 @@ void resample_image_chunk(const ResampleParams<real>& params) {
                                   convolve(params.image_in, static_cast<real>(i), j_vec[2], params.a, params.R, params.lanczos_values),
                                   convolve(params.image_in, static_cast<real>(i), j_vec[3], params.a, params.R, params.lanczos_values) };
 
-            v4sf rounded_vec = __builtin_ia32_roundps(convolve_vec, 0x00);
+            // Round to nearest even by adding and subtracting 1.5 * 2^23 (needs only SSE2, unlike roundps)
+            const v4sf magic = {12582912.0f, 12582912.0f, 12582912.0f, 12582912.0f};
+            v4sf rounded_vec = __builtin_ia32_subps(__builtin_ia32_addps(convolve_vec, magic), magic);
             v4sf min_vec = __builtin_ia32_minps(rounded_vec, (v4sf){255.0f, 255.0f, 255.0f, 255.0f});
             v4sf max_vec = __builtin_ia32_maxps(min_vec, (v4sf){0.0f, 0.0f, 0.0f, 0.0f});
 
@@ -156,8 +159,52 @@ void resample_image_chunk(const ResampleParams<real>& params) {
     }
 }
 
+// Resampling kernel compiled for each instruction set, so one binary runs on any x86-64 CPU
+void resample_sse2(const ResampleParams<float>& params) {
+    resample_image_chunk(params);
+}
+
+__attribute__((target("avx2"))) void resample_avx2(const ResampleParams<float>& params) {
+    resample_image_chunk(params);
+}
+
+__attribute__((target("avx512f"))) void resample_avx512(const ResampleParams<float>& params) {
+    resample_image_chunk(params);
+}
+
+typedef void (*ResampleKernel)(const ResampleParams<float>&);
+
+// Choose the resampling kernel: the requested instruction set (auto/sse2/avx2/avx512), or the best one the CPU supports
+ResampleKernel select_resample(const string& isa) {
+    bool avx512 = __builtin_cpu_supports("avx512f");
+    bool avx2 = __builtin_cpu_supports("avx2");
+
+    if ((isa == "avx512" && !avx512) || (isa == "avx2" && !avx2)) {
+        cerr << "Instruction set not supported by this CPU: " << isa << endl;
+        exit(1);
+    }
+    if (isa == "sse2") {
+        cerr << "Instruction set: sse2" << endl;
+        return resample_sse2;
+    }
+    if (isa == "avx2" || (isa == "auto" && avx2 && !avx512)) {
+        cerr << "Instruction set: avx2" << endl;
+        return resample_avx2;
+    }
+    if (isa == "avx512" || (isa == "auto" && avx512)) {
+        cerr << "Instruction set: avx512" << endl;
+        return resample_avx512;
+    }
+    if (isa != "auto") {
+        cerr << "Unknown instruction set: " << isa << " (expected auto, sse2, avx2 or avx512)" << endl;
+        exit(1);
+    }
+    cerr << "Instruction set: sse2" << endl;
+    return resample_sse2;
+}
+
 template <class real>
-void process(const string infile, const string outfile, const real R, const int a) {
+void process(const string infile, const string outfile, const real R, const int a, const string isa) {
     // Load image
     jbutil::image<int> image_in;
     ifstream file_in(infile.c_str());
@@ -170,6 +217,9 @@ void process(const string infile, const string outfile, const real R, const int
     int new_height = int(image_in.get_rows() * R);
     jbutil::image<int> image_out(new_height, new_width, 1);
 
+    // Choose the resampling kernel for this CPU
+    ResampleKernel resample = select_resample(isa);
+
     // Allocate memory for lanczos_values
     jbutil::vector<real> lanczos_values;
 
@@ -187,7 +237,7 @@ void process(const string infile, const string outfile, const real R, const int
         int start_col = t * chunk_size + min(t, remainder); 
         int end_col = start_col + chunk_size + (t < remainder ? 1 : 0); 
         ResampleParams<real> params = {image_in, image_out, R, a, lanczos_values, start_col, end_col};
-        threads.emplace_back(resample_image_chunk<real>, params);
+        threads.emplace_back(resample, params);
     }
 
     // Join threads
@@ -208,11 +258,13 @@ void process(const string infile, const string outfile, const real R, const int
 // Main program entry point
 int main(int argc, char *argv[]) {
     cerr << "Lab 2: Image resampling with Lanczos filter" << endl;
-    if (argc != 5) {
+    if (argc != 5 && argc != 6) {
         cerr << "Usage: " << argv[0]
-             << " <infile> <outfile> <scale-factor> <limit>" << endl;
+             << " <infile> <outfile> <scale-factor> <limit> [auto|sse2|avx2|avx512]" << endl;
         exit(1);
     }
-    process<float>(argv[1], argv[2], atof(argv[3]), atoi(argv[4]));
+    // The instruction set is taken from the last argument, then LAB2_ISA, then detected
+    string isa = argc == 6 ? argv[5] : (getenv("LAB2_ISA") ? getenv("LAB2_ISA") : "auto");
+    process<float>(argv[1], argv[2], atof(argv[3]), atoi(argv[4]), isa);
     return 0;
 }
\ No newline at end of file